@@ -0,0 +1,26 @@
+#version 330 core
+
+in Varyings {
+    vec2 unlit_tex_coord;
+    vec2 lit_tex_coord;
+    float intensity;
+} fs_in;
+
+out vec4 frag_color;
+
+uniform sampler2D atlas;
+
+void main(){
+    // The first column of the atlas holds the sprites without any light (ambient and emissive only),
+    // and the other columns hold the sprites lit by a single light of intensity 1.
+    // Since the lighting is additive, mixing them by the light intensity gives the sprite lit by that light.
+    vec4 unlit = texture(atlas, fs_in.unlit_tex_coord);
+    vec4 lit = texture(atlas, fs_in.lit_tex_coord);
+    frag_color = mix(unlit, lit, fs_in.intensity);
+
+    // The pixels outside of the sphere are transparent in the atlas. We discard them
+    // so that the impostors can be drawn with the opaque objects (with depth writing).
+    if (frag_color.a < 0.5) {
+        discard;
+    }
+}
@@ -0,0 +1,49 @@
+#version 330 core
+
+// The per-instance data of the impostors:
+// center_radius: the world position of the orb center (xyz) and its radius (w).
+// tile: the atlas row of the material (x), the atlas column of the lit sprite (y),
+//       the rotation of the sprite around the view direction (z) and the light intensity (w).
+layout(location = 0) in vec4 center_radius;
+layout(location = 1) in vec4 tile;
+
+// VP is the view and projection matrix multiplied.
+uniform mat4 VP;
+
+// The camera right and up vectors (in the world space), used to face the quads towards the camera.
+uniform vec3 camera_right;
+uniform vec3 camera_up;
+
+// The size of one tile in the atlas (in texture coordinates).
+uniform vec2 tile_size;
+
+out Varyings {
+    vec2 unlit_tex_coord;
+    vec2 lit_tex_coord;
+    float intensity;
+} vs_out;
+
+void main(){
+    // The 4 corners of the quad (drawn as a triangle strip), so no vertex buffer is needed.
+    vec2 corners[] = vec2[](
+        vec2(-1.0, -1.0),
+        vec2( 1.0, -1.0),
+        vec2(-1.0,  1.0),
+        vec2( 1.0,  1.0)
+    );
+    vec2 corner = corners[gl_VertexID];
+
+    // The sprites are baked with the light coming from the right side of the tile.
+    // So we rotate the quad such that the right side of the sprite points towards the light on the screen.
+    float c = cos(tile.z), s = sin(tile.z);
+    vec2 rotated = vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+
+    // The sprites are baked with some padding around the sphere, so the quad is slightly bigger than the sphere.
+    vec3 world = center_radius.xyz + (camera_right * rotated.x + camera_up * rotated.y) * (center_radius.w * 1.1);
+    gl_Position = VP * vec4(world, 1.0);
+
+    vec2 tile_coord = corner * 0.5 + 0.5;
+    vs_out.unlit_tex_coord = (vec2(0.0, tile.x) + tile_coord) * tile_size;
+    vs_out.lit_tex_coord = (vec2(tile.y, tile.x) + tile_coord) * tile_size;
+    vs_out.intensity = tile.w;
+}
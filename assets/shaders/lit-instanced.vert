@@ -0,0 +1,41 @@
+#version 330
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in vec3 normal;
+
+// The model matrix of the instance (locations 4 to 7).
+layout(location = 4) in mat4 M;
+
+// The normal matrix of the instance (locations 8 to 10), which is the
+// inverse transpose of the upper 3x3 part of the model matrix.
+// Both matrices are computed on the CPU once per instance and read from the instance buffer.
+layout(location = 8) in mat3 M_IT;
+
+// VP is the view and projection matrix multiplied.
+uniform mat4 VP;
+
+// The camera position.
+uniform vec3 camera_position;
+
+out Varyings {
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 view;
+    vec3 world;
+} vs_out;
+
+void main() {
+
+    // This is the same as lit.vert, except that M and M_IT come from the instance attributes.
+    vec3 world = (M * vec4(position, 1.0)).xyz;
+    vs_out.world = world;
+
+    gl_Position = VP * vec4(world, 1.0);
+
+    vs_out.tex_coord = tex_coord;
+
+    vs_out.normal = normalize(M_IT * normal);
+
+    vs_out.view = camera_position - world;
+}
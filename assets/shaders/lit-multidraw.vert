@@ -0,0 +1,53 @@
+#version 330
+// gl_DrawIDARB gives the index of the draw inside a glMultiDrawElementsBaseVertex call.
+// If the extension is missing, the renderer draws the commands one by one and sets "draw_id" instead.
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in vec3 normal;
+
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_ID gl_DrawIDARB
+#else
+uniform int draw_id;
+#define DRAW_ID draw_id
+#endif
+
+// The per-draw data of the batch: 7 texels per draw, the 4 columns of the model matrix
+// followed by the 3 columns of the normal matrix (the w components of those are unused).
+uniform samplerBuffer draw_data;
+
+// VP is the view and projection matrix multiplied.
+uniform mat4 VP;
+
+// The camera position.
+uniform vec3 camera_position;
+
+out Varyings {
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 view;
+    vec3 world;
+} vs_out;
+
+void main() {
+
+    // This is the same as lit.vert, except that M and M_IT are read from the per-draw data.
+    int base = DRAW_ID * 7;
+    mat4 M = mat4(texelFetch(draw_data, base), texelFetch(draw_data, base + 1),
+                  texelFetch(draw_data, base + 2), texelFetch(draw_data, base + 3));
+    mat3 M_IT = mat3(texelFetch(draw_data, base + 4).xyz, texelFetch(draw_data, base + 5).xyz,
+                     texelFetch(draw_data, base + 6).xyz);
+
+    vec3 world = (M * vec4(position, 1.0)).xyz;
+    vs_out.world = world;
+
+    gl_Position = VP * vec4(world, 1.0);
+
+    vs_out.tex_coord = tex_coord;
+
+    vs_out.normal = normalize(M_IT * normal);
+
+    vs_out.view = camera_position - world;
+}
@@ -14,11 +14,12 @@ uniform vec3 camera_position;
 // The model matrix.
 uniform mat4 M;
 
-// The inverse of the model matrix transposed.
+// The inverse of the upper 3x3 part of the model matrix transposed (the normal matrix).
 // This could've been calculated here, in the GPU, from the above M
 // but it's more computationally expensive, given that it'll
 // be calculated for every vertex (the vertex shader is called for every vertex).
-uniform mat4 M_IT;
+// Only the 3x3 part is needed since the translation doesn't affect the normals.
+uniform mat3 M_IT;
 
 out Varyings {
     vec2 tex_coord;
@@ -44,7 +45,7 @@ void main() {
 
     // Setting the normal vector to the surface at the fragment's position.
     // It's calculated as : normalize(Transpose(Inverse(World Matrix)) * NormalVector)
-    vs_out.normal = normalize((M_IT * vec4(normal, 0.0)).xyz);
+    vs_out.normal = normalize(M_IT * normal);
 
     // The view vector is the direction from the camera position to
     // the fragment's position in the world.
@@ -1,5 +1,17 @@
 #version 330
 
+// This is a per-pixel effect: it only reads the scene pixel at its own position,
+// so the renderer can fuse it with the neighbouring per-pixel effects of a chain into one pass
+// (the fused shader defines POSTPROCESS_FUSED and calls "per_pixel" itself).
+vec4 per_pixel(vec4 color, vec2 coord){
+    // To apply the grayscale effect, we compute the average of the red/blue/green channels
+    // and set that average value to all the channels
+    float gray = dot(color.rgb, vec3(1.0/3.0, 1.0/3.0, 1.0/3.0));
+    return vec4(vec3(gray), color.a);
+}
+
+#ifndef POSTPROCESS_FUSED
+
 // The texture holding the scene pixels
 uniform sampler2D tex;
 
@@ -8,9 +20,7 @@ in vec2 tex_coord;
 out vec4 frag_color;
 
 void main(){
-    // To apply the grayscale effect, we compute the average of the red/blue/green channels
-    // and set that average value to all the channels
-    frag_color = texture(tex, tex_coord);
-    float gray = dot(frag_color.rgb, vec3(1.0/3.0, 1.0/3.0, 1.0/3.0));
-    frag_color.rgb = vec3(gray);
-}
\ No newline at end of file
+    frag_color = per_pixel(texture(tex, tex_coord), tex_coord);
+}
+
+#endif
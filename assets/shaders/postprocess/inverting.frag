@@ -1,11 +1,19 @@
 #version 330
 
+// This is a per-pixel effect (see grayscale.frag).
+vec4 per_pixel(vec4 color, vec2 coord){
+    return vec4(1 - color.r, 1 - color.g, 1 - color.b, color.a);
+}
+
+#ifndef POSTPROCESS_FUSED
+
 uniform sampler2D tex;
 
 in vec2 tex_coord;
 out vec4 frag_color;
 
 void main() {
-    frag_color = texture(tex, tex_coord);
-    frag_color = vec4(1 - frag_color.r, 1 - frag_color.g, 1 - frag_color.b, frag_color.a);
-}
\ No newline at end of file
+    frag_color = per_pixel(texture(tex, tex_coord), tex_coord);
+}
+
+#endif
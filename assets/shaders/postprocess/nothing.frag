@@ -1,9 +1,8 @@
 #version 330
 
-// This nothing.frag postprocess shader is used to evade something.
-// Currently, the text is only rendered when there is a postprocess effect applied.
-// I couldn't debug this, so I created a postprocess shader that does nothing if 
-// we desire no effect.
+// This nothing.frag postprocess shader outputs the scene as is.
+// The renderer detects it as an identity effect, so while it is in effect, the scene
+// is drawn directly to the default framebuffer and this shader isn't actually used.
 uniform sampler2D tex;
 
 in vec2 tex_coord;
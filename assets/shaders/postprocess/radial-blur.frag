@@ -7,17 +7,29 @@ uniform sampler2D tex;
 in vec2 tex_coord;
 out vec4 frag_color;
 
-// The number of samples we read to compute the blurring effect
+// The number of samples we read (in total) to compute the blurring effect
 #define STEPS 16
 // The strength of the blurring effect
 #define STRENGTH 0.2
 
+// The blur can be computed in multiple iterations, each reading the output of the previous one
+// (see the "iterations" of the postprocess effects in "postprocessor.hpp").
+uniform int iteration = 0;
+uniform int iterations = 1;
+
 void main(){
-    // To apply radial blur, we compute the direction outward from the center to the current pixel
-    vec2 step_vector = (tex_coord - 0.5) * (STRENGTH / STEPS);
-    // Then we sample multiple pixels along that direction and compute the average
-    for(int i = 0; i < STEPS; i++){
+    // Comment:
+    // To apply radial blur, we compute the direction outward from the center to the current pixel,
+    // then we sample multiple pixels along that direction and compute the average.
+    // With N iterations, every iteration only reads STEPS^(1/N) samples, but each one spaces its samples
+    // STEPS^(1/N) times further than the previous iteration did. Averaging averages this way gives the same
+    // STEPS evenly spaced samples as a single iteration (e.g. 2 iterations of 4 samples instead of 16 samples).
+    int steps = int(round(pow(float(STEPS), 1.0 / float(iterations))));
+    float spacing = STRENGTH / pow(float(steps), float(iterations - iteration));
+    vec2 step_vector = (tex_coord - 0.5) * spacing;
+    frag_color = vec4(0.0);
+    for(int i = 0; i < steps; i++){
         frag_color += texture(tex, tex_coord + step_vector * i);    
     }
-    frag_color /= STEPS;
-}
\ No newline at end of file
+    frag_color /= steps;
+}
@@ -1,17 +1,10 @@
 #version 330
 
-// The texture holding the scene pixels
-uniform sampler2D tex;
-
-// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
-in vec2 tex_coord;
-
-out vec4 frag_color;
-
 // Vignette is a postprocessing effect that darkens the corners of the screen
 // to grab the attention of the viewer towards the center of the screen
+// This is a per-pixel effect (see grayscale.frag).
 
-void main(){
+vec4 per_pixel(vec4 color, vec2 coord){
     //DONE: (Req 11) Modify this shader to apply vignette
     // To apply vignette, divide the scene color
     // by 1 + the squared length of the 2D pixel location the NDC space
@@ -22,8 +15,23 @@ void main(){
     // Comment:
     // Apply equation: y = 2x - 1, on each coordinate, where y is the new coordinate value in NDC (x`, y`, z`), 
     // and x is the original coordinate value (x, y, z) in the texture coordinates.
-    vec2 ndc_coords = vec2((2 * tex_coord.x) - 1, (2*tex_coord.y) - 1);
+    vec2 ndc_coords = vec2((2 * coord.x) - 1, (2*coord.y) - 1);
     float squaredLength = pow(ndc_coords.x,2) + pow(ndc_coords.y, 2);
-    frag_color = texture(tex, tex_coord);
-    frag_color = frag_color / (1 + squaredLength);
-}
\ No newline at end of file
+    return color / (1 + squaredLength);
+}
+
+#ifndef POSTPROCESS_FUSED
+
+// The texture holding the scene pixels
+uniform sampler2D tex;
+
+// Read "assets/shaders/fullscreen.vert" to know what "tex_coord" holds;
+in vec2 tex_coord;
+
+out vec4 frag_color;
+
+void main(){
+    frag_color = per_pixel(texture(tex, tex_coord), tex_coord);
+}
+
+#endif
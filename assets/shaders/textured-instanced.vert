@@ -0,0 +1,24 @@
+#version 330 core
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+
+// The model matrix of the instance. It is read from the instance buffer
+// (one matrix per instance), so it occupies the locations 4, 5, 6 and 7.
+layout(location = 4) in mat4 M;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+} vs_out;
+
+// VP is the view and projection matrix multiplied.
+// It is shared by all the instances.
+uniform mat4 VP;
+
+void main(){
+    gl_Position = VP * (M * vec4(position, 1.0));
+    vs_out.color = color;
+    vs_out.tex_coord = tex_coord;
+}
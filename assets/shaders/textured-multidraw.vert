@@ -0,0 +1,36 @@
+#version 330 core
+// gl_DrawIDARB gives the index of the draw inside a glMultiDrawElementsBaseVertex call.
+// If the extension is missing, the renderer draws the commands one by one and sets "draw_id" instead.
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_ID gl_DrawIDARB
+#else
+uniform int draw_id;
+#define DRAW_ID draw_id
+#endif
+
+// The per-draw data of the batch: 7 texels per draw, starting with the 4 columns of the model matrix.
+uniform samplerBuffer draw_data;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+} vs_out;
+
+// VP is the view and projection matrix multiplied.
+// It is shared by all the draws.
+uniform mat4 VP;
+
+void main(){
+    int base = DRAW_ID * 7;
+    mat4 M = mat4(texelFetch(draw_data, base), texelFetch(draw_data, base + 1),
+                  texelFetch(draw_data, base + 2), texelFetch(draw_data, base + 3));
+    gl_Position = VP * (M * vec4(position, 1.0));
+    vs_out.color = color;
+    vs_out.tex_coord = tex_coord;
+}
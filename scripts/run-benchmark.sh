@@ -0,0 +1,17 @@
+#!/bin/sh
+# Runs the benchmark described in the "benchmark" section of a config without a window, then compares the results
+# against a baseline (if one is given). The exit code is 1 if the benchmark failed (e.g. a frame allocated more than the
+# config allows) or if the comparison found a regression.
+# The benchmark runs the scene of its config with a fixed seed (1 by default), so the runs build the same world and can be compared.
+# Usage: scripts/run-benchmark.sh [config (default: config/app.jsonc)] [results (default: benchmarks/results.json)] [baseline] [seed (default: 1)]
+
+config="${1:-config/app.jsonc}"
+results="${2:-benchmarks/results.json}"
+baseline="$3"
+seed="${4:-1}"
+
+./bin/GAME_APPLICATION --headless --benchmark -c="$config" --benchmark-output="$results" --seed="$seed" || exit $?
+
+if [ -n "$baseline" ]; then
+    ./bin/BENCHMARK_COMPARE -b="$baseline" -r="$results" || exit $?
+fi
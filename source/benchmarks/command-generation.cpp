@@ -0,0 +1,99 @@
+// This benchmark measures how the render command generation (see "systems/command-generation.hpp")
+// scales with the number of threads. It builds a scene with many entities (100k by default), then times
+// the generation of the commands at 1, 2, 4, 8 and 16 threads and prints the speedup over a single thread.
+// Usage: COMMAND_GENERATION_BENCHMARK [-n entity_count] [-r repetitions]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <flags/flags.h>
+
+#include <ecs/world.hpp>
+#include <mesh/mesh-utils.hpp>
+#include <systems/command-generation.hpp>
+
+int main(int argc, char** argv) {
+    flags::args args(argc, argv);
+    int entityCount = args.get<int>("n", 100000);
+    int repetitions = args.get<int>("r", 20);
+
+    // The meshes are OpenGL objects, so we need a context (in a hidden window) to create them.
+    if (!glfwInit()) {
+        std::cerr << "ERROR: FAILED TO INITIALIZE GLFW" << std::endl;
+        return -1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Command Generation Benchmark", nullptr, nullptr);
+    if (!window) {
+        std::cerr << "ERROR: FAILED TO CREATE A WINDOW" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    gladLoadGL(glfwGetProcAddress);
+
+    // Comment:
+    // The scene mimics the game: most entities are orbs, a third of them have a parent (like the moons), and a tenth
+    // of them are transparent. Only the "transparent" flag of the materials is read by the generation.
+    our::Mesh* mesh = our::mesh_utils::sphere(glm::ivec2(16, 8));
+    our::Material opaqueMaterial, transparentMaterial;
+    opaqueMaterial.transparent = false;
+    transparentMaterial.transparent = true;
+
+    {
+        our::World world;
+        std::srand(0);
+        our::Entity* previous = nullptr;
+        for (int index = 0; index < entityCount; index++) {
+            our::Entity* entity = world.add();
+            entity->parent = (index % 3 == 2) ? previous : nullptr;
+            entity->localTransform.position = glm::vec3(std::rand() % 500, std::rand() % 100, -(std::rand() % 5000));
+            entity->localTransform.rotation = glm::vec3(0.0f, (std::rand() % 628) / 100.0f, 0.0f);
+            entity->localTransform.scale = glm::vec3(1.0f + std::rand() % 4);
+            our::MeshRendererComponent* renderer = entity->addComponent<our::MeshRendererComponent>();
+            renderer->mesh = mesh;
+            renderer->material = (index % 10 == 0) ? &transparentMaterial : &opaqueMaterial;
+            previous = entity;
+        }
+
+        std::vector<our::RenderCommand> opaqueCommands, transparentCommands;
+        our::CommandGenerator generator;
+        double singleThreaded = 0.0;
+
+        std::cout << "Generating the commands of " << entityCount << " entities (median of " << repetitions << " runs)" << std::endl;
+        for (int threads : {1, 2, 4, 8, 16}) {
+            our::ThreadPool pool(threads - 1);
+            std::vector<double> times;
+            for (int repetition = 0; repetition < repetitions + 2; repetition++) {
+                opaqueCommands.clear();
+                transparentCommands.clear();
+                auto start = std::chrono::steady_clock::now();
+                generator.generate(&world, nullptr, &pool, opaqueCommands, transparentCommands);
+                auto end = std::chrono::steady_clock::now();
+                // The first two runs warm up the caches and the buffers, so they are not counted.
+                if (repetition >= 2) times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            double median = times[times.size() / 2];
+            if (threads == 1) singleThreaded = median;
+
+            std::cout << std::setw(2) << threads << " threads: " << std::fixed << std::setprecision(3) << median << " ms"
+                      << " (speedup: " << std::setprecision(2) << singleThreaded / median << "x, "
+                      << opaqueCommands.size() << " opaque, " << transparentCommands.size() << " transparent)" << std::endl;
+        }
+    }
+
+    delete mesh;
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
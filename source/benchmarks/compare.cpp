@@ -0,0 +1,84 @@
+// This tool compares the results of a benchmark run (see "common/benchmark.hpp") against a baseline run.
+// For every statistic of the frame times, the system times and the draw call, triangle & allocation counts, it prints the baseline
+// value, the new value and the relative change, and flags the statistic if it got worse by more than the threshold.
+// To ignore the noise of tiny timings, a time is only flagged if it also got worse by more than "min-difference" milliseconds.
+// A statistic that was 0 in the baseline has an infinite change if it grew, so any increase of a count (e.g. allocations) is flagged.
+// It exits with 1 if any statistic regressed (so it can be used in scripts), and 0 otherwise.
+// Usage: BENCHMARK_COMPARE -b baseline.json -r results.json [-t threshold (default: 0.05)] [-m min-difference (default: 0.05 ms)]
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+
+#include <flags/flags.h>
+#include <json/json.hpp>
+
+static bool load(const std::string& path, nlohmann::json& result) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "ERROR: COULDN'T OPEN THE BENCHMARK RESULTS: " << path << std::endl;
+        return false;
+    }
+    result = nlohmann::json::parse(file, nullptr, false);
+    if (result.is_discarded()) {
+        std::cerr << "ERROR: COULDN'T PARSE THE BENCHMARK RESULTS: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    flags::args args(argc, argv);
+    std::string baselinePath = args.get<std::string>("b", "");
+    std::string resultsPath = args.get<std::string>("r", "");
+    double threshold = args.get<double>("t", 0.05);
+    double minDifference = args.get<double>("m", 0.05);
+    if (baselinePath.empty() || resultsPath.empty()) {
+        std::cerr << "Usage: BENCHMARK_COMPARE -b baseline.json -r results.json [-t threshold] [-m min-difference]" << std::endl;
+        return -1;
+    }
+
+    nlohmann::json baseline, results;
+    if (!load(baselinePath, baseline) || !load(resultsPath, results)) return -1;
+    if (baseline.value("renderer", "") != results.value("renderer", ""))
+        std::cout << "WARNING: THE RUNS USED DIFFERENT RENDERERS (" << baseline.value("renderer", "") << " AND "
+                  << results.value("renderer", "") << ")" << std::endl;
+
+    int regressions = 0;
+    // Compares one statistic. "isTime" decides whether the minimum difference applies.
+    auto compare = [&](const std::string& name, const nlohmann::json& before, const nlohmann::json& after, bool isTime) {
+        if (!before.is_number() || !after.is_number()) return;
+        double oldValue = before.get<double>(), newValue = after.get<double>();
+        double change = oldValue > 0.0 ? (newValue - oldValue) / oldValue
+                                       : (newValue > oldValue ? std::numeric_limits<double>::infinity() : 0.0);
+        bool regressed = change > threshold && (!isTime || newValue - oldValue > minDifference);
+        bool improved = change < -threshold && (!isTime || oldValue - newValue > minDifference);
+        std::printf("%-40s %12.3f %12.3f %+8.1f%% %s\n", name.c_str(), oldValue, newValue, change * 100.0,
+                    regressed ? "REGRESSION" : (improved ? "improved" : ""));
+        if (regressed) regressions++;
+    };
+    // Compares the statistics that both runs have in the given summaries (see "summarize" in "benchmark.cpp").
+    auto compareSummary = [&](const std::string& name, const nlohmann::json& before, const nlohmann::json& after, bool isTime) {
+        if (!before.is_object() || !after.is_object()) return;
+        for (const char* statistic : {"mean", "p50", "p95", "p99"})
+            if (before.contains(statistic) && after.contains(statistic))
+                compare(name + " " + statistic, before[statistic], after[statistic], isTime);
+    };
+
+    std::printf("%-40s %12s %12s %9s\n", "", "baseline", "results", "change");
+    compareSummary("frame time (ms)", baseline["frame-time-ms"], results["frame-time-ms"], true);
+    if (baseline["systems-ms"].is_object() && results["systems-ms"].is_object()) {
+        for (auto& [system, summary] : baseline["systems-ms"].items())
+            if (results["systems-ms"].contains(system))
+                compareSummary(system + " (ms)", summary, results["systems-ms"][system], true);
+    }
+    // The counts don't have noise (the runs draw the same frames), so only their means are compared.
+    for (const char* counter : {"draw-calls", "triangles", "allocations"})
+        if (baseline[counter].is_object() && results[counter].is_object())
+            compare(std::string(counter) + " mean", baseline[counter]["mean"], results[counter]["mean"], false);
+
+    if (regressions) std::cout << regressions << " statistics regressed by more than " << threshold * 100.0 << "%" << std::endl;
+    else std::cout << "No regressions" << std::endl;
+    return regressions ? 1 : 0;
+}
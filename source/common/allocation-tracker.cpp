@@ -0,0 +1,149 @@
+#include "allocation-tracker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace our {
+
+    namespace {
+        // The number of slots. The threads that start after all the slots are taken share the last one.
+        constexpr size_t MAX_THREADS = 64;
+
+        // The counts of one thread. Only its thread adds to them (except in the shared last slot), so the atomic additions
+        // are uncontended, and the slots are aligned to cache lines so the threads don't invalidate each other's slots.
+        struct alignas(64) ThreadSlot {
+            std::atomic<uint64_t> allocations{0}, bytes{0};
+        };
+
+        // These are constant-initialized (they don't need a constructor to run), so they are ready for the allocations
+        // that happen while the other globals are constructed.
+        ThreadSlot slots[MAX_THREADS];
+        std::atomic<size_t> nextSlot{0};
+        thread_local ThreadSlot* threadSlot = nullptr;
+
+        ThreadSlot& getThreadSlot() {
+            if (!threadSlot) threadSlot = &slots[std::min(nextSlot.fetch_add(1, std::memory_order_relaxed), MAX_THREADS - 1)];
+            return *threadSlot;
+        }
+    }
+
+#if defined(ENABLE_ALLOCATION_TRACKING)
+
+    namespace {
+        // Counts the allocation, then allocates like the default operator new (calling the new handler until it succeeds).
+        void* allocate(size_t size) {
+            ThreadSlot& slot = getThreadSlot();
+            slot.allocations.fetch_add(1, std::memory_order_relaxed);
+            slot.bytes.fetch_add(size, std::memory_order_relaxed);
+            if (size == 0) size = 1;
+            while (true) {
+                if (void* memory = std::malloc(size)) return memory;
+                std::new_handler handler = std::get_new_handler();
+                if (!handler) throw std::bad_alloc();
+                handler();
+            }
+        }
+
+        void* allocateNoThrow(size_t size) noexcept {
+            try {
+                return allocate(size);
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        // The same for the over-aligned allocations (e.g. the types declared with alignas(64)).
+        // The size is rounded up to a multiple of the alignment, as aligned_alloc requires.
+        void* allocateAligned(size_t size, std::align_val_t alignment) {
+            ThreadSlot& slot = getThreadSlot();
+            slot.allocations.fetch_add(1, std::memory_order_relaxed);
+            slot.bytes.fetch_add(size, std::memory_order_relaxed);
+            size_t align = static_cast<size_t>(alignment);
+            size = std::max<size_t>((size + align - 1) / align * align, align);
+            while (true) {
+#if defined(_WIN32)
+                if (void* memory = _aligned_malloc(size, align)) return memory;
+#else
+                if (void* memory = std::aligned_alloc(align, size)) return memory;
+#endif
+                std::new_handler handler = std::get_new_handler();
+                if (!handler) throw std::bad_alloc();
+                handler();
+            }
+        }
+
+        void* allocateAlignedNoThrow(size_t size, std::align_val_t alignment) noexcept {
+            try {
+                return allocateAligned(size, alignment);
+            } catch (...) {
+                return nullptr;
+            }
+        }
+
+        void freeAligned(void* memory) noexcept {
+#if defined(_WIN32)
+            _aligned_free(memory);
+#else
+            std::free(memory);
+#endif
+        }
+    }
+
+    bool AllocationTracker::isEnabled() { return true; }
+
+#else
+
+    bool AllocationTracker::isEnabled() { return false; }
+
+#endif
+
+    AllocationCounts AllocationTracker::getThreadCounts() {
+        ThreadSlot& slot = getThreadSlot();
+        return {slot.allocations.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed)};
+    }
+
+    AllocationCounts AllocationTracker::getTotalCounts() {
+        AllocationCounts counts;
+        size_t used = std::min(nextSlot.load(std::memory_order_relaxed), MAX_THREADS);
+        for (size_t index = 0; index < used; index++) {
+            counts.allocations += slots[index].allocations.load(std::memory_order_relaxed);
+            counts.bytes += slots[index].bytes.load(std::memory_order_relaxed);
+        }
+        return counts;
+    }
+
+}
+
+#if defined(ENABLE_ALLOCATION_TRACKING)
+
+// The replaced global allocation functions (all the forms are replaced, so every allocation is counted and freed by the matching function).
+void* operator new(std::size_t size) { return our::allocate(size); }
+void* operator new[](std::size_t size) { return our::allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return our::allocateNoThrow(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return our::allocateNoThrow(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return our::allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return our::allocateAligned(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return our::allocateAlignedNoThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return our::allocateAlignedNoThrow(size, alignment); }
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { our::freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { our::freeAligned(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { our::freeAligned(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { our::freeAligned(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { our::freeAligned(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { our::freeAligned(memory); }
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace our {
+
+    // A number of heap allocations (made with operator new) and the bytes they requested.
+    struct AllocationCounts {
+        uint64_t allocations = 0, bytes = 0;
+
+        AllocationCounts operator-(const AllocationCounts& other) const { return {allocations - other.allocations, bytes - other.bytes}; }
+    };
+
+    // Counts the heap allocations made by every thread.
+    // Comment:
+    // The global operator new (and its array, nothrow and aligned forms) is replaced to count every allocation and its size
+    // before forwarding it to malloc (or aligned_alloc for the aligned forms), and operator delete forwards to free. Every thread counts its allocations in its own slot
+    // (on its own cache line), so counting never contends between threads, and the counts of a thread can be read on their own
+    // (e.g. around a profiler zone, see "profiler.hpp") or added up with the counts of the other threads (e.g. for a whole frame).
+    // The counts only grow, so the allocations made during some code are the difference between the counts after and before it.
+    // Allocations that don't go through operator new (malloc in C libraries, ImGui) are not counted, but the ones of the C++
+    // libraries are: e.g. irrKlang allocates every sound it plays (like the coin sound), and llvmpipe compiles its shaders with
+    // LLVM on their first draw (see the prewarming in ForwardRenderer::render).
+    // The allocations are only counted if the project is built with ENABLE_ALLOCATION_TRACKING (see the CMake option, which
+    // is off by default so the shipped game keeps the default operator new). Otherwise, operator new is not replaced and all the counts are 0.
+    class AllocationTracker {
+    public:
+        // Returns true if the allocations are counted (i.e. the project was built with ENABLE_ALLOCATION_TRACKING).
+        static bool isEnabled();
+
+        // Returns the allocations made by the calling thread since it started.
+        static AllocationCounts getThreadCounts();
+        // Returns the allocations made by all the threads since the program started.
+        static AllocationCounts getTotalCounts();
+    };
+
+}
@@ -25,6 +25,7 @@
 #endif
 
 #include "texture/screenshot.hpp"
+#include "our-util.hpp"
 
 std::string default_screenshot_filepath() {
 
@@ -156,32 +157,40 @@ our::WindowConfiguration our::Application::getWindowConfiguration() {
 // if run_for_frames == 0, the application runs indefinitely till manually closed.
 int our::Application::run(int run_for_frames) {
 
-    // Set the function to call when an error occurs.
-    glfwSetErrorCallback(glfw_error_callback);
+    if(headless) {
+        // In headless mode, we don't initialize GLFW (it needs a display). We only create an offscreen context
+        // with a default framebuffer of the configured window size.
+        headlessSize = getWindowConfiguration().size;
+        if(!headlessContext.create(headlessSize)) return -1;
+        std::cout << "HEADLESS CONTEXT: " << headlessContext.getBackend() << std::endl;
+    } else {
+        // Set the function to call when an error occurs.
+        glfwSetErrorCallback(glfw_error_callback);
+
+        // Initialize GLFW and exit if it failed
+        if(!glfwInit()){
+            std::cerr << "Failed to Initialize GLFW" << std::endl;
+            return -1;
+        }
 
-    // Initialize GLFW and exit if it failed
-    if(!glfwInit()){
-        std::cerr << "Failed to Initialize GLFW" << std::endl;
-        return -1;
-    }
+        configureOpenGL(); // This function sets OpenGL window hints.
 
-    configureOpenGL(); // This function sets OpenGL window hints.
+        auto win_config = getWindowConfiguration();             // Returns the WindowConfiguration current struct instance.
 
-    auto win_config = getWindowConfiguration();             // Returns the WindowConfiguration current struct instance.
+        // Create a window with the given "WindowConfiguration" attributes.
+        // If it should be fullscreen, monitor should point to one of the monitors (e.g. primary monitor), otherwise it should be null
+        GLFWmonitor* monitor = win_config.isFullscreen ? glfwGetPrimaryMonitor() : nullptr;
+        // The last parameter "share" can be used to share the resources (OpenGL objects) between multiple windows.
+        window = glfwCreateWindow(win_config.size.x, win_config.size.y, win_config.title.c_str(), monitor, nullptr);
+        if(!window) {
+            std::cerr << "Failed to Create Window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);         // Tell GLFW to make the context of our window the main context on the current thread.
 
-    // Create a window with the given "WindowConfiguration" attributes.
-    // If it should be fullscreen, monitor should point to one of the monitors (e.g. primary monitor), otherwise it should be null
-    GLFWmonitor* monitor = win_config.isFullscreen ? glfwGetPrimaryMonitor() : nullptr;
-    // The last parameter "share" can be used to share the resources (OpenGL objects) between multiple windows.
-    window = glfwCreateWindow(win_config.size.x, win_config.size.y, win_config.title.c_str(), monitor, nullptr);
-    if(!window) {
-        std::cerr << "Failed to Create Window" << std::endl;
-        glfwTerminate();
-        return -1;
+        gladLoadGL(glfwGetProcAddress);         // Load the OpenGL functions from the driver
     }
-    glfwMakeContextCurrent(window);         // Tell GLFW to make the context of our window the main context on the current thread.
-
-    gladLoadGL(glfwGetProcAddress);         // Load the OpenGL functions from the driver
 
     // Print information about the OpenGL context
     std::cout << "VENDOR          : " << glGetString(GL_VENDOR) << std::endl;
@@ -201,9 +210,35 @@ int our::Application::run(int run_for_frames) {
 #endif
 
 
-    setupCallbacks();
-    keyboard.enable(window);
-    mouse.enable(window);
+    // A benchmark runs a fixed number of frames as fast as possible (so the vertical synchronization is disabled).
+    if(benchmark.isActive()) {
+        run_for_frames = benchmark.getTotalFrames();
+        if(window) glfwSwapInterval(0);
+    }
+
+    if(window) setupCallbacks();
+    if(!replayPath.empty()) {
+        // A replay starts from a clean input state (with the recorded cursor position) and uses the recorded seed.
+        if(!inputReplayer.open(replayPath)) return -1;
+        keyboard.enable(nullptr);
+        mouse.enable(nullptr);
+        mouse.setPosition(inputReplayer.getCursorPosition());
+        setRandomSeed(inputReplayer.getSeed());
+    } else if(window) {
+        keyboard.enable(window);
+        mouse.enable(window);
+    } else {
+        // Without a window, there is no user input.
+        keyboard.disable();
+        mouse.disable();
+    }
+    if(!recordPath.empty()) {
+        // The seed is recorded, so it is fixed for the run even if none was given.
+        setRandomSeed(getRandomSeed());
+        if(!inputRecorder.open(recordPath, randomSeed, mouse.getMousePosition())) return -1;
+        // The replay starts without any pressed keys, so the recording starts the same way.
+        keyboard.enable(nullptr);
+    }
 
     // Start the ImGui context and set dark style (just my preference :D)
     IMGUI_CHECKVERSION();
@@ -212,9 +247,28 @@ int our::Application::run(int run_for_frames) {
     ImGui::StyleColorsDark();
 
     // Initialize ImGui for GLFW and OpenGL
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    // (Without a window, the display size and the delta time are set by us every frame instead of the GLFW backend).
+    if(window) ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
+    // Read the configuration of the quality governor (it is disabled if there is none, and in runs whose frames must not
+    // depend on the speed of the machine: benchmarks, headless runs and the runs that take screenshots, see below).
+    nlohmann::json quality_config = app_config.value("quality", nlohmann::json::object());
+    qualityGovernor.initialize(quality_config);
+    showQualityOverlay = quality_config.value("show-overlay", false);
+
+    // Read the configuration of the profiler. When it is enabled, the trace is written when F11 is pressed and at exit.
+    // The profiler also runs while the performance HUD is visible (it shows the zones), but the trace isn't written at exit then.
+    nlohmann::json profiler_config = app_config.value("profiler", nlohmann::json::object());
+    profilePath = profiler_config.value("output", "profiles/trace.json");
+    profiling = profiling || profiler_config.value("enabled", false);
+    performanceHUD.setVisible(profiler_config.value("show-hud", false));
+    our::Profiler::setThreadName("main");
+    our::Profiler::setEnabled(profiling || performanceHUD.isVisible());
+
+    // Start recording the metrics of every frame (if the configuration or the command line asks for it).
+    metricsRecorder.open(app_config.value("metrics", nlohmann::json::object()), metricsPath);
+
     // This part of the code extracts the list of requested screenshots and puts them into a priority queue
     using ScreenshotRequest = std::pair<int, std::string>;
     std::priority_queue<
@@ -240,29 +294,68 @@ int our::Application::run(int run_for_frames) {
     // Call onInitialize if the scene needs to do some custom initialization (such as file loading, object creation, etc).
     if(currentState) currentState->onInitialize();
 
+    // The quality is kept fixed in a benchmark (so the results of different runs can be compared), in headless mode and
+    // in the runs that take screenshots (so they are drawn at the full quality).
+    bool govern_quality = qualityGovernor.isEnabled() && !benchmark.isActive() && !headless && run_for_frames == 0 && requested_screenshots.empty();
+
     // The time at which the last frame started. But there was no frames yet, so we'll just pick the current time.
-    double last_frame_time = glfwGetTime();
+    double last_frame_time = our::getTime();
     int current_frame = 0;
 
+    // In headless mode, the frame times are summarized at the end of the run (since there is no window to show them).
+    double total_frame_time = 0, max_frame_time = 0;
+
     //Game loop
-    while(!glfwWindowShouldClose(window)){
+    while(!closeRequested && !(window && glfwWindowShouldClose(window))){
         if(run_for_frames != 0 && current_frame >= run_for_frames) break;
-        glfwPollEvents(); // Read all the user events and call relevant callbacks.
-
-        // Start a new ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-
-        if(currentState) currentState->onImmediateGui(); // Call to run any required Immediate GUI.
+        OUR_PROFILE_ZONE("frame");
+        double frame_start_time = our::getTime();
+        our::AllocationCounts frame_start_allocations = our::AllocationTracker::getTotalCounts();
+
+        // If a recording is replayed, send its events of this frame (instead of the user events) and read the delta time of the frame.
+        double recorded_delta_time = -1.0;
+        {
+            OUR_PROFILE_ZONE("poll events");
+            if(window) glfwPollEvents(); // Read all the user events and call relevant callbacks.
+
+            if(inputReplayer.isReplaying()) {
+                const InputEvent* event;
+                while((event = inputReplayer.next()) && event->type != InputEventType::FRAME) dispatchInputEvent(*event);
+                if(!event) {
+                    std::cout << "The input recording ended after " << current_frame << " frames" << std::endl;
+                    break;
+                }
+                recorded_delta_time = event->deltaTime;
+            }
+        }
 
-        // If ImGui is using the mouse or keyboard, then we don't want the captured events to affect our keyboard and mouse objects.
-        // For example, if you're focusing on an input and writing "W", the keyboard object shouldn't record this event.
-        keyboard.setEnabled(!io.WantCaptureKeyboard, window);
-        mouse.setEnabled(!io.WantCaptureMouse, window);
+        {
+            OUR_PROFILE_ZONE("imgui");
+            // Start a new ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            if(window) {
+                ImGui_ImplGlfw_NewFrame();
+            } else {
+                io.DisplaySize = ImVec2((float)headlessSize.x, (float)headlessSize.y);
+                io.DeltaTime = (float)std::max(our::getTime() - last_frame_time, 1e-4);
+            }
+            ImGui::NewFrame();
+
+            if(currentState) currentState->onImmediateGui(); // Call to run any required Immediate GUI.
+            if(showQualityOverlay && qualityGovernor.isEnabled()) qualityGovernor.drawOverlay();
+            performanceHUD.draw();
+
+            // If ImGui is using the mouse or keyboard, then we don't want the captured events to affect our keyboard and mouse objects.
+            // For example, if you're focusing on an input and writing "W", the keyboard object shouldn't record this event.
+            // While recording or replaying, they stay enabled (the replay can't know what ImGui captured while recording).
+            if(window && !inputRecorder.isRecording() && !inputReplayer.isReplaying()) {
+                keyboard.setEnabled(!io.WantCaptureKeyboard, window);
+                mouse.setEnabled(!io.WantCaptureMouse, window);
+            }
 
-        // Render the ImGui commands we called (this doesn't actually draw to the screen yet.
-        ImGui::Render();
+            // Render the ImGui commands we called (this doesn't actually draw to the screen yet.
+            ImGui::Render();
+        }
 
         // Just in case ImGui changed the OpenGL viewport (the portion of the window to which we render the geometry),
         // we set it back to cover the whole window
@@ -270,10 +363,24 @@ int our::Application::run(int run_for_frames) {
         glViewport(0, 0, frame_buffer_size.x, frame_buffer_size.y);
 
         // Get the current time (the time at which we are starting the current frame).
-        double current_frame_time = glfwGetTime();
+        double current_frame_time = our::getTime();
         
         // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
-        if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
+        // (In a benchmark, a fixed time step is sent instead, so every run draws the same frames. While replaying a recording,
+        // the recorded delta time can be sent instead, so the replay simulates exactly the same frames as the recording).
+        double delta_time = current_frame_time - last_frame_time;
+        if(benchmark.isActive()) delta_time = benchmark.getTimeStep();
+        else if(forceRecordedDeltas && recorded_delta_time >= 0.0) delta_time = recorded_delta_time;
+        if(currentState) {
+            OUR_PROFILE_ZONE("state draw");
+            currentState->onDraw(delta_time);
+        }
+        inputRecorder.endFrame(delta_time);
+        if(current_frame > 0) {
+            performanceHUD.addFrameTime(current_frame_time - last_frame_time);
+            total_frame_time += current_frame_time - last_frame_time;
+            max_frame_time = std::max(max_frame_time, current_frame_time - last_frame_time);
+        }
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
 
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
@@ -281,7 +388,10 @@ int our::Application::run(int run_for_frames) {
         glDisable(GL_DEBUG_OUTPUT);
         glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 #endif
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+        {
+            OUR_PROFILE_ZONE("imgui draw");
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // Render the ImGui to the framebuffer
+        }
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
         // Re-enable the debug messages
         glEnable(GL_DEBUG_OUTPUT);
@@ -310,41 +420,108 @@ int our::Application::run(int run_for_frames) {
             } else break;
         }
 
+        // If F3 is pressed, show or hide the performance HUD (it can also be closed from its window).
+        // The profiler runs while the HUD is visible, since the HUD shows its zones.
+        if(keyboard.justPressed(GLFW_KEY_F3)) performanceHUD.setVisible(!performanceHUD.isVisible());
+        if(bool profiler_needed = profiling || performanceHUD.isVisible(); profiler_needed != our::Profiler::isEnabled())
+            our::Profiler::setEnabled(profiler_needed);
+
+        // If F11 is pressed while profiling, write the zones recorded so far (the file name gets the current frame).
+        if(our::Profiler::isEnabled() && keyboard.justPressed(GLFW_KEY_F11)){
+            std::filesystem::path path(profilePath);
+            path.replace_filename(path.stem().string() + "-frame-" + std::to_string(current_frame) + path.extension().string());
+            our::Profiler::writeChromeTrace(path.string());
+        }
+
+        // The CPU time of the frame, without the swap (which waits for the vertical synchronization).
+        double cpu_frame_time = our::getTime() - frame_start_time;
+
         // Swap the frame buffers
-        glfwSwapBuffers(window);
+        // In headless mode, there is nothing to swap, so we wait for the frame to finish instead
+        // (otherwise, the frame times would only measure how fast the commands are queued).
+        benchmark.beginSystem("present");
+        {
+            OUR_PROFILE_ZONE("swap");
+            if(window) glfwSwapBuffers(window);
+            else glFinish();
+        }
+        benchmark.endSystem();
+
+        // Let the quality governor adjust the settings (used by the next frame) based on the work of the frame.
+        // The CPU and the GPU work in parallel, so the work takes as long as the slower of them. The wall time of the frame
+        // can't be used, since with the vertical synchronization, it never gets below the refresh period.
+        if(govern_quality) qualityGovernor.update(std::max(cpu_frame_time, gpuFrameTime));
 
         // Update the keyboard and mouse data
         keyboard.update();
         mouse.update();
 
         // If a scene change was requested, apply it
+        OUR_PROFILE_ZONE("state change");
         while(nextState){
             // If a scene was already running, destroy it (not delete since we can go back to it later)
             if(currentState) currentState->onDestroy();
-            // Switch scenes
+            // Switch scenes (the HUD drops the data reported by the old one)
+            performanceHUD.clearStateData();
             currentState = nextState;
             nextState = nullptr;
             // Initialize the new scene
             currentState->onInitialize();
         }
 
+        // The allocations of the frame are counted on all the threads (the workers of the renderer allocate too).
+        double frame_duration = our::getTime() - frame_start_time;
+        our::AllocationCounts frame_allocations = our::AllocationTracker::getTotalCounts() - frame_start_allocations;
+        performanceHUD.addFrameAllocations(frame_allocations);
+        benchmark.addAllocations(frame_allocations);
+        benchmark.endFrame(frame_duration);
+        if(metricsRecorder.isRecording()) {
+            our::metrics::frameTime.set((int64_t)(frame_duration * 1e6));
+            our::metrics::allocations.set((int64_t)frame_allocations.allocations);
+            our::metrics::allocatedBytes.set((int64_t)frame_allocations.bytes);
+            metricsRecorder.endFrame(current_frame);
+        }
         ++current_frame;
     }
 
+    // Write the results of the benchmark (if any) while the context is still alive.
+    // If a measured frame made more heap allocations than the benchmark allows, the run fails (see "benchmark.hpp").
+    bool benchmark_failed = false;
+    if(benchmark.isActive()) {
+        benchmark.write(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+        benchmark_failed = !benchmark.checkAllocationLimit();
+    }
+
+    inputRecorder.close();
+    metricsRecorder.close();
+
+    // Write the zones of the profiler (if it was enabled by the configuration or the command line).
+    if(profiling) our::Profiler::writeChromeTrace(profilePath);
+
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
 
+    if(headless && current_frame > 1) {
+        std::cout << "HEADLESS RUN: " << current_frame << " FRAMES, MEAN FRAME TIME: "
+                  << 1000.0 * total_frame_time / (current_frame - 1) << " ms, MAX FRAME TIME: "
+                  << 1000.0 * max_frame_time << " ms" << std::endl;
+    }
+
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if(window) ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    // Destroy the window
-    glfwDestroyWindow(window);
+    if(window) {
+        // Destroy the window
+        glfwDestroyWindow(window);
 
-    // And finally terminate GLFW
-    glfwTerminate();
-    return 0; // Good bye
+        // And finally terminate GLFW
+        glfwTerminate();
+    } else {
+        headlessContext.destroy();
+    }
+    return benchmark_failed ? 1 : 0; // Good bye
 }
 
 // Sets-up the window callback functions from GLFW to our (Mouse/Keyboard) classes.
@@ -359,12 +536,15 @@ void our::Application::setupCallbacks() {
     // a seperate function for it.
     // In the inline function we retrieve the window instance and use it to set our (Mouse/Keyboard) classes values.
 
+    // Every callback turns its parameters into an input event (see "input/input-recording.hpp") and passes it to "onInputEvent".
     // Keyboard callbacks
     glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods){
         auto* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
         if(app){
-            app->getKeyboard().keyEvent(key, scancode, action, mods);
-            if(app->currentState) app->currentState->onKeyEvent(key, scancode, action, mods);
+            InputEvent event;
+            event.type = InputEventType::KEY;
+            event.code = key; event.scancode = scancode; event.action = action; event.mods = mods;
+            app->onInputEvent(event);
         }
     });
 
@@ -372,8 +552,10 @@ void our::Application::setupCallbacks() {
     glfwSetCursorPosCallback(window, [](GLFWwindow* window, double x_position, double y_position){
         auto* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
         if(app){
-            app->getMouse().CursorMoveEvent(x_position, y_position);
-            if(app->currentState) app->currentState->onCursorMoveEvent(x_position, y_position);
+            InputEvent event;
+            event.type = InputEventType::CURSOR_MOVE;
+            event.x = x_position; event.y = y_position;
+            app->onInputEvent(event);
         }
     });
 
@@ -381,7 +563,10 @@ void our::Application::setupCallbacks() {
     glfwSetCursorEnterCallback(window, [](GLFWwindow* window, int entered){
         auto* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
         if(app){
-            if(app->currentState) app->currentState->onCursorEnterEvent(entered);
+            InputEvent event;
+            event.type = InputEventType::CURSOR_ENTER;
+            event.code = entered;
+            app->onInputEvent(event);
         }
     });
 
@@ -389,8 +574,10 @@ void our::Application::setupCallbacks() {
     glfwSetMouseButtonCallback(window, [](GLFWwindow* window, int button, int action, int mods){
         auto* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
         if(app){
-            app->getMouse().MouseButtonEvent(button, action, mods);
-            if(app->currentState) app->currentState->onMouseButtonEvent(button, action, mods);
+            InputEvent event;
+            event.type = InputEventType::MOUSE_BUTTON;
+            event.code = button; event.action = action; event.mods = mods;
+            app->onInputEvent(event);
         }
     });
 
@@ -398,8 +585,44 @@ void our::Application::setupCallbacks() {
     glfwSetScrollCallback(window, [](GLFWwindow* window, double x_offset, double y_offset){
         auto* app = static_cast<Application*>(glfwGetWindowUserPointer(window));
         if(app){
-            app->getMouse().ScrollEvent(x_offset, y_offset);
-            if(app->currentState) app->currentState->onScrollEvent(x_offset, y_offset);
+            InputEvent event;
+            event.type = InputEventType::SCROLL;
+            event.x = x_offset; event.y = y_offset;
+            app->onInputEvent(event);
         }
     });
 }
+
+// Handles an input event received from GLFW: it is recorded (if recording), then sent to our classes and the current state.
+// While replaying a recording, the events from GLFW are ignored (the recorded events are sent instead).
+void our::Application::onInputEvent(const InputEvent& event) {
+    inputRecorder.record(event);
+    if(!inputReplayer.isReplaying()) dispatchInputEvent(event);
+}
+
+// Sends an input event to our (Mouse/Keyboard) classes and to the current state.
+void our::Application::dispatchInputEvent(const InputEvent& event) {
+    switch (event.type) {
+        case InputEventType::KEY:
+            keyboard.keyEvent(event.code, event.scancode, event.action, event.mods);
+            if(currentState) currentState->onKeyEvent(event.code, event.scancode, event.action, event.mods);
+            break;
+        case InputEventType::CURSOR_MOVE:
+            mouse.CursorMoveEvent(event.x, event.y);
+            if(currentState) currentState->onCursorMoveEvent(event.x, event.y);
+            break;
+        case InputEventType::CURSOR_ENTER:
+            if(currentState) currentState->onCursorEnterEvent(event.code);
+            break;
+        case InputEventType::MOUSE_BUTTON:
+            mouse.MouseButtonEvent(event.code, event.action, event.mods);
+            if(currentState) currentState->onMouseButtonEvent(event.code, event.action, event.mods);
+            break;
+        case InputEventType::SCROLL:
+            mouse.ScrollEvent(event.x, event.y);
+            if(currentState) currentState->onScrollEvent(event.x, event.y);
+            break;
+        case InputEventType::FRAME:
+            break;
+    }
+}
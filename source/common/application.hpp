@@ -12,9 +12,11 @@
 
 #include "input/keyboard.hpp"
 #include "input/mouse.hpp"
+#include "input/input-recording.hpp"
 
 #include <iostream>
 #include <map>
+#include <ctime>
 
 // This is for the sound library.
 #include <irrKlang.h>
@@ -22,6 +24,13 @@
 
 #include "../states/extra-definitions.hpp"
 #include "./text-utils.hpp"
+#include "./quality-governor.hpp"
+#include "./headless-context.hpp"
+#include "./benchmark.hpp"
+#include "./profiler.hpp"
+#include "./metrics.hpp"
+#include "./allocation-tracker.hpp"
+#include "./performance-hud.hpp"
 
 namespace our {
 
@@ -78,6 +87,13 @@ namespace our {
     class Application {
     protected:
         GLFWwindow * window = nullptr;      // Pointer to the window created by GLFW using "glfwCreateWindow()".
+
+        // In headless mode, there is no window (and GLFW isn't initialized). The frames are drawn into an offscreen
+        // buffer of the configured window size instead, which is what "getWindowSize" and "getFrameBufferSize" return.
+        bool headless = false;
+        HeadlessContext headlessContext;
+        glm::ivec2 headlessSize = glm::ivec2(0);
+        bool closeRequested = false;        // Replaces "glfwWindowShouldClose" in headless mode.
         
         Keyboard keyboard;                  // Instance of "our" keyboard class that handles keyboard functionalities.
         Mouse mouse;                        // Instance of "our" mouse class that handles mouse functionalities.
@@ -100,11 +116,45 @@ namespace our {
         // Map containing all character maps.
         std::map<char, Character> *Characters = NULL;
 
+        // Lowers (or raises) the rendering quality to keep the frame time under the target in the "quality" configuration.
+        QualityGovernor qualityGovernor;
+        // Whether the current quality level and knobs are drawn in an ImGui window.
+        bool showQualityOverlay = false;
+        // The GPU time (in seconds) of the last frame measured by the current state (see "reportGPUTime").
+        double gpuFrameTime = 0.0;
+
+        // Measures the frames of a benchmark run (inactive unless "enableBenchmark" is called).
+        Benchmark benchmark;
+
+        // The input can be recorded to a file, or replayed from a file instead of the user input (see "input/input-recording.hpp").
+        std::string recordPath, replayPath;
+        InputRecorder inputRecorder;
+        InputReplayer inputReplayer;
+        // Whether the replay sends the recorded delta times to the states instead of the real ones.
+        bool forceRecordedDeltas = false;
+
+        // The seed of the random number generator used by the states to build the scene (see "getRandomSeed").
+        unsigned int randomSeed = 0;
+        bool fixedRandomSeed = false;
+
+        // Whether the zones of the profiler are recorded from the start (see "profiler.hpp"), and the path of the trace written at exit.
+        bool profiling = false;
+        std::string profilePath;
+        // Shows the frame times, the profiler zones, the GPU times and the counts of the current state (toggled with F3).
+        PerformanceHUD performanceHUD;
+
+        // Appends the metrics (frame time, draw calls, etc.) of every frame to a file (see "metrics.hpp").
+        // The path given on the command line (if any) overrides the "metrics" configuration.
+        std::string metricsPath;
+        MetricsRecorder metricsRecorder;
+
         // Virtual functions to be overrode and change the default behaviour of the application
         // according to the example needs.
         virtual void configureOpenGL();                             // This function sets OpenGL Window Hints in GLFW.
         virtual WindowConfiguration getWindowConfiguration();       // Returns the WindowConfiguration current struct instance.
         virtual void setupCallbacks();                             // Sets-up the window callback functions from GLFW to our (Mouse/Keyboard) classes.
+        void onInputEvent(const InputEvent& event);                 // Called by the callbacks for every input event received from GLFW.
+        void dispatchInputEvent(const InputEvent& event);           // Sends an input event to our (Mouse/Keyboard) classes and the current state.
 
     public:
 
@@ -164,9 +214,42 @@ namespace our {
 
         // Closes the Application
         void close(){
-            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            closeRequested = true;
+            if(window) glfwSetWindowShouldClose(window, GLFW_TRUE);
         }
 
+        // Makes the application run without a window (see "headless"). It must be called before "run".
+        void setHeadless(bool headless) { this->headless = headless; }
+        [[nodiscard]] bool isHeadless() const { return headless; }
+
+        // Runs the benchmark described by the "benchmark" configuration (see "benchmark.hpp"). It must be called before "run".
+        // If the output path is not empty, it replaces the output path in the configuration.
+        // If the benchmark fixes a random seed, it is used (unless another one is given later, e.g. by "--seed").
+        void enableBenchmark(const std::string& outputPath) {
+            benchmark.setOutputPath(outputPath);
+            benchmark.initialize(app_config.value("benchmark", nlohmann::json::object()));
+            if(auto seed = benchmark.getSeed()) setRandomSeed(*seed);
+        }
+        Benchmark& getBenchmark() { return benchmark; }
+
+        // Records the input of the run to the given file. It must be called before "run".
+        void enableRecording(const std::string& path) { recordPath = path; }
+        // Replays the input recorded in the given file instead of the user input (and uses its random seed).
+        // If "forceDeltas" is true, the states get the recorded delta times instead of the real ones. It must be called before "run".
+        void enableReplay(const std::string& path, bool forceDeltas) { replayPath = path; forceRecordedDeltas = forceDeltas; }
+
+        // Records the zones of the profiler even if the "profiler" configuration doesn't enable it. It must be called before "run".
+        void enableProfiling() { profiling = true; }
+
+        // Records the metrics of every frame to the given file even if the "metrics" configuration doesn't enable it. It must be called before "run".
+        void enableMetrics(const std::string& path) { metricsPath = path; }
+
+        // Fixes the seed returned by "getRandomSeed".
+        void setRandomSeed(unsigned int seed) { randomSeed = seed; fixedRandomSeed = true; }
+        // Returns the seed that the states should use for their random number generator: the fixed seed if there is one
+        // (given on the command line, or read from a replayed recording), or the current time otherwise.
+        [[nodiscard]] unsigned int getRandomSeed() const { return fixedRandomSeed ? randomSeed : (unsigned int)std::time(nullptr); }
+
         // Class Getters.
         GLFWwindow* getWindow(){ return window; }
         [[nodiscard]] const GLFWwindow* getWindow() const { return window; }
@@ -177,8 +260,18 @@ namespace our {
 
         [[nodiscard]] const nlohmann::json& getConfig() const { return app_config; }
 
+        // The HUD to which the states report their counts and GPU times (see "performance-hud.hpp").
+        PerformanceHUD& getPerformanceHUD() { return performanceHUD; }
+
+        // The quality settings picked by the quality governor for the next frame.
+        [[nodiscard]] const QualitySettings& getQualitySettings() const { return qualityGovernor.getSettings(); }
+        // The states report the GPU time (in seconds) of the last frame they measured, so the quality governor can see
+        // the work of the GPU without the time spent waiting for the swap (see "run").
+        void reportGPUTime(double seconds) { gpuFrameTime = seconds; }
+
         // Get the size of the frame buffer of the window in pixels.
         glm::ivec2 getFrameBufferSize() {
+            if(headless) return headlessSize;
             glm::ivec2 size;
             glfwGetFramebufferSize(window, &(size.x), &(size.y));
             return size;
@@ -187,6 +280,7 @@ namespace our {
         // Get the window size. In most cases, it is equal to the frame buffer size.
         // But on some platforms, the framebuffer size may be different from the window size.
         glm::ivec2 getWindowSize() {
+            if(headless) return headlessSize;
             glm::ivec2 size;
             glfwGetWindowSize(window, &(size.x), &(size.y));
             return size;
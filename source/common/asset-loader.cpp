@@ -19,6 +19,9 @@ namespace our {
     // This will load all the shaders defined in "data"
     // data must be in the form:
     //    { shader_name : { "vs" : "path/to/vertex-shader", "fs" : "path/to/fragment-shader" }, ... }
+    // A shader can optionally define "instanced-vs" which is a vertex shader that reads the model matrices from instance attributes.
+    // If defined, it is linked with the same fragment shader into the shader's "instancedVariant".
+    // Similarly, "multidraw-vs" is a vertex shader that reads the model matrices from the per-draw data, and is linked into "multiDrawVariant".
     template<>
     void AssetLoader<ShaderProgram>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
@@ -29,6 +32,20 @@ namespace our {
                 shader->attach(vsPath, GL_VERTEX_SHADER);
                 shader->attach(fsPath, GL_FRAGMENT_SHADER);
                 shader->link();
+
+                if(std::string instancedPath = desc.value("instanced-vs", ""); !instancedPath.empty()){
+                    shader->instancedVariant = new ShaderProgram();
+                    shader->instancedVariant->attach(instancedPath, GL_VERTEX_SHADER);
+                    shader->instancedVariant->attach(fsPath, GL_FRAGMENT_SHADER);
+                    shader->instancedVariant->link();
+                }
+
+                if(std::string multiDrawPath = desc.value("multidraw-vs", ""); !multiDrawPath.empty()){
+                    shader->multiDrawVariant = new ShaderProgram();
+                    shader->multiDrawVariant->attach(multiDrawPath, GL_VERTEX_SHADER);
+                    shader->multiDrawVariant->attach(fsPath, GL_FRAGMENT_SHADER);
+                    shader->multiDrawVariant->link();
+                }
                 assets[name] = shader;
             }
         }
@@ -68,12 +85,34 @@ namespace our {
     // This will load all the meshes defined in "data"
     // data must be in the form:
     //    { mesh_name : "path/to/3d-model-file", ... }
+    // A mesh can also be generated instead of loaded from a file, in which case its description is an object.
+    // Currently, the only generated mesh is a chain of spheres used as levels of detail:
+    //    { mesh_name : { "type": "sphere", "lods": [[longitude_segments, latitude_segments], ...] }, ... }
+    // A model file can also be simplified into levels of detail when it is loaded:
+    //    { mesh_name : { "path": "path/to/3d-model-file", "lod": { "levels": 3, "error": 0.02, "ratio": 0.5 } }, ... }
+    // where "levels" is the total number of levels (including the original), "error" is the maximum error of the first
+    // coarser level relative to the mesh radius (and grows linearly with the level), and "ratio" is the fraction of
+    // triangles kept by each level relative to the previous one.
     template<>
     void AssetLoader<Mesh>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
-                std::string path = desc.get<std::string>();
-                assets[name] = mesh_utils::loadOBJ(path);
+                if(desc.is_string()){
+                    std::string path = desc.get<std::string>();
+                    assets[name] = mesh_utils::loadOBJ(path);
+                } else if(desc.is_object() && desc.value("type", "") == "sphere"){
+                    std::vector<glm::ivec2> segments;
+                    for(auto& level : desc.value("lods", nlohmann::json::array()))
+                        segments.push_back(glm::ivec2(level[0].get<int>(), level[1].get<int>()));
+                    if(segments.empty()) segments.push_back(glm::ivec2(32, 16));
+                    assets[name] = mesh_utils::sphereLODs(segments);
+                } else if(desc.is_object() && desc.contains("path")){
+                    std::string path = desc["path"].get<std::string>();
+                    nlohmann::json lod = desc.value("lod", nlohmann::json::object());
+                    assets[name] = mesh_utils::loadOBJ(path, lod.value("levels", 1), lod.value("error", 0.02f), lod.value("ratio", 0.5f));
+                } else {
+                    std::cerr << "ERROR: UNKNOWN MESH DESCRIPTION FOR: " << name << std::endl;
+                }
             }
         }
     };
@@ -169,6 +208,25 @@ namespace our {
             AssetLoader<MultipleMeshes>::deserialize(assetData["multiple-meshes"]);
     }
 
+    std::vector<AssetMemory> getAssetMemoryUsage(){
+        AssetMemory textures = {"Textures", AssetLoader<Texture2D>::getAll().size(), 0};
+        for(auto& [name, texture] : AssetLoader<Texture2D>::getAll()) textures.bytes += texture->getMemorySize();
+        AssetMemory gifs = {"GIFs", AssetLoader<GIFTexture>::getAll().size(), 0};
+        for(auto& [name, gif] : AssetLoader<GIFTexture>::getAll())
+            for(auto texture : gif->textures) gifs.bytes += texture->getMemorySize();
+        AssetMemory meshes = {"Meshes", AssetLoader<Mesh>::getAll().size(), 0};
+        for(auto& [name, mesh] : AssetLoader<Mesh>::getAll()) meshes.bytes += mesh->getMemorySize();
+        AssetMemory multipleMeshes = {"Multiple meshes", AssetLoader<MultipleMeshes>::getAll().size(), 0};
+        for(auto& [name, multiple] : AssetLoader<MultipleMeshes>::getAll())
+            if(multiple->listOfMeshes) for(auto mesh : *multiple->listOfMeshes) multipleMeshes.bytes += mesh->getMemorySize();
+        return {
+            textures, gifs, meshes, multipleMeshes,
+            {"Shaders", AssetLoader<ShaderProgram>::getAll().size(), 0},
+            {"Samplers", AssetLoader<Sampler>::getAll().size(), 0},
+            {"Materials", AssetLoader<Material>::getAll().size(), 0}
+        };
+    }
+
     void clearAllAssets(){
         AssetLoader<ShaderProgram>::clear();
         AssetLoader<Texture2D>::clear();
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <json/json.hpp>
 #include <iostream>
 
@@ -34,6 +35,11 @@ namespace our {
             return nullptr;
         };
 
+        // Returns all the loaded assets of this type by name.
+        static const std::unordered_map<std::string, T*>& getAll() {
+            return assets;
+        }
+
         static void add(const std::string &name, T* item) {
             assets[name] = item;
         }
@@ -54,4 +60,14 @@ namespace our {
     void deserializeAllAssets(const nlohmann::json& assetData);
     // This will call "AssetLoader<T>::clear" for all the different asset types T
     void clearAllAssets();
+
+    // The number of loaded assets of one type, and the (GPU) memory they use in bytes (0 for the types that don't hold any data).
+    struct AssetMemory {
+        const char* type;
+        size_t count;
+        size_t bytes;
+    };
+    // Returns the number and memory of the loaded assets of every type. It queries the sizes of the textures from OpenGL,
+    // so it shouldn't be called every frame.
+    std::vector<AssetMemory> getAssetMemoryUsage();
 }
\ No newline at end of file
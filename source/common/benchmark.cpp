@@ -0,0 +1,178 @@
+#include "benchmark.hpp"
+#include "deserialize-utils.hpp"
+#include "our-util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+
+namespace our {
+
+    // Returns the minimum, mean, percentiles and maximum of the given values (the percentiles use the nearest rank).
+    static nlohmann::json summarize(std::vector<float> values) {
+        if (values.empty()) return nlohmann::json::object();
+        std::sort(values.begin(), values.end());
+        auto percentile = [&values](double p) {
+            size_t rank = (size_t)std::ceil(p * values.size());
+            return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+        };
+        double sum = std::accumulate(values.begin(), values.end(), 0.0);
+        return {
+            {"min", values.front()},
+            {"mean", sum / values.size()},
+            {"p50", percentile(0.50)},
+            {"p95", percentile(0.95)},
+            {"p99", percentile(0.99)},
+            {"max", values.back()}
+        };
+    }
+
+    void Benchmark::initialize(const nlohmann::json& config) {
+        active = true;
+        name = config.value("name", "benchmark");
+        scene = config.value("scene", "");
+        if (config.contains("seed")) seed = config["seed"].get<unsigned int>();
+        else seed.reset();
+        warmupFrames = std::max(config.value("warmup-frames", 120), 0);
+        measuredFrames = std::max(config.value("frames", 600), 1);
+        timeStep = config.value("time-step", 1.0 / 60.0);
+        maxAllocationsPerFrame = config.value("max-allocations-per-frame", -1LL);
+        if (outputPath.empty()) outputPath = config.value("output", "benchmarks/" + name + ".json");
+
+        cameraPath.clear();
+        if (auto path = config.find("camera-path"); path != config.end() && path->is_array()) {
+            for (auto& point : *path) {
+                CameraKeyframe keyframe;
+                keyframe.time = point.value("time", 0.0f);
+                keyframe.position = point.value("position", keyframe.position);
+                keyframe.rotation = glm::radians(point.value("rotation", keyframe.rotation));
+                cameraPath.push_back(keyframe);
+            }
+            std::sort(cameraPath.begin(), cameraPath.end(),
+                [](const CameraKeyframe& first, const CameraKeyframe& second) { return first.time < second.time; });
+        }
+
+        frame = 0;
+        frameTimes.reserve(measuredFrames);
+        drawCalls.reserve(measuredFrames);
+        triangles.reserve(measuredFrames);
+        allocations.reserve(measuredFrames);
+        allocatedBytes.reserve(measuredFrames);
+        framesOverAllocationLimit = 0;
+        firstFrameOverAllocationLimit = -1;
+    }
+
+    bool Benchmark::sampleCamera(glm::vec3& position, glm::vec3& rotation) const {
+        if (!active || cameraPath.empty()) return false;
+
+        // The keyframes are interpolated linearly, and the camera stays at the last one when the path ends.
+        float time = (float)(frame * timeStep);
+        auto next = std::find_if(cameraPath.begin(), cameraPath.end(), [time](const CameraKeyframe& keyframe) { return keyframe.time > time; });
+        if (next == cameraPath.begin() || next == cameraPath.end()) {
+            const CameraKeyframe& keyframe = (next == cameraPath.end()) ? cameraPath.back() : cameraPath.front();
+            position = keyframe.position;
+            rotation = keyframe.rotation;
+            return true;
+        }
+        auto previous = next - 1;
+        float t = (time - previous->time) / (next->time - previous->time);
+        position = glm::mix(previous->position, next->position, t);
+        rotation = glm::mix(previous->rotation, next->rotation, t);
+        return true;
+    }
+
+    void Benchmark::beginSystem(const char* systemName) {
+        // The systems are registered during the warmup, so registering them doesn't allocate in the measured frames.
+        if (!active) return;
+        auto it = std::find_if(systems.begin(), systems.end(), [systemName](const SystemTimes& system) { return system.name == systemName; });
+        if (it == systems.end()) {
+            systems.push_back({systemName});
+            systems.back().times.reserve(measuredFrames);
+            it = systems.end() - 1;
+        }
+        if (!isMeasuring()) return;
+        runningSystem = &*it;
+        systemStart = getTime();
+    }
+
+    void Benchmark::endSystem() {
+        if (!runningSystem) return;
+        runningSystem->current += getTime() - systemStart;
+        runningSystem = nullptr;
+    }
+
+    void Benchmark::addRenderCounts(int drawCalls, int triangles) {
+        frameDrawCalls += drawCalls;
+        frameTriangles += triangles;
+    }
+
+    void Benchmark::addAllocations(const AllocationCounts& allocations) {
+        frameAllocations.allocations += allocations.allocations;
+        frameAllocations.bytes += allocations.bytes;
+    }
+
+    void Benchmark::endFrame(double frameTime) {
+        if (isMeasuring()) {
+            frameTimes.push_back((float)(frameTime * 1000.0));
+            drawCalls.push_back(frameDrawCalls);
+            triangles.push_back(frameTriangles);
+            allocations.push_back((float)frameAllocations.allocations);
+            allocatedBytes.push_back((float)frameAllocations.bytes);
+            if (maxAllocationsPerFrame >= 0 && frameAllocations.allocations > (uint64_t)maxAllocationsPerFrame) {
+                if (framesOverAllocationLimit++ == 0) firstFrameOverAllocationLimit = frame;
+            }
+            for (auto& system : systems) {
+                system.times.push_back((float)(system.current * 1000.0));
+                system.current = 0.0;
+            }
+        }
+        frameDrawCalls = frameTriangles = 0;
+        frameAllocations = {};
+        frame++;
+    }
+
+    bool Benchmark::write(const std::string& renderer) const {
+        nlohmann::json result = {
+            {"name", name},
+            {"renderer", renderer},
+            {"warmup-frames", warmupFrames},
+            {"frames", frameTimes.size()},
+            {"time-step", timeStep},
+            {"frame-time-ms", summarize(frameTimes)}
+        };
+        nlohmann::json& systemsResult = result["systems-ms"] = nlohmann::json::object();
+        for (auto& system : systems) systemsResult[system.name] = summarize(system.times);
+        result["draw-calls"] = summarize(std::vector<float>(drawCalls.begin(), drawCalls.end()));
+        result["triangles"] = summarize(std::vector<float>(triangles.begin(), triangles.end()));
+        if (AllocationTracker::isEnabled()) {
+            result["allocations"] = summarize(allocations);
+            result["allocated-bytes"] = summarize(allocatedBytes);
+        }
+
+        std::error_code error;
+        std::filesystem::path path(outputPath);
+        if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+        std::ofstream file(path);
+        if (!file) {
+            std::cerr << "ERROR: COULDN'T WRITE THE BENCHMARK RESULTS TO: " << outputPath << std::endl;
+            return false;
+        }
+        file << result.dump(4) << std::endl;
+        std::cout << "Benchmark results saved to: " << outputPath << std::endl;
+        return true;
+    }
+
+    bool Benchmark::checkAllocationLimit() const {
+        // Without the allocation tracking, every count is 0, so the limit can't fail (but it isn't really checked either).
+        if (maxAllocationsPerFrame >= 0 && !AllocationTracker::isEnabled())
+            std::cerr << "WARNING: THE ALLOCATIONS ARE NOT COUNTED (BUILD WITH ENABLE_ALLOCATION_TRACKING TO CHECK THE LIMIT)" << std::endl;
+        if (framesOverAllocationLimit == 0) return true;
+        std::cerr << "ERROR: " << framesOverAllocationLimit << " BENCHMARK FRAMES MADE MORE THAN " << maxAllocationsPerFrame
+                  << " HEAP ALLOCATIONS (THE FIRST ONE IS FRAME " << firstFrameOverAllocationLimit << ")" << std::endl;
+        return false;
+    }
+
+}
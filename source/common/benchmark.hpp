@@ -0,0 +1,104 @@
+#pragma once
+
+#include "allocation-tracker.hpp"
+
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace our {
+
+    // A point of the scripted camera path of a benchmark.
+    // The position is relative to the initial position of the camera, and the rotation is in degrees (like in the world config).
+    struct CameraKeyframe {
+        float time = 0.0f;
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);
+    };
+
+    // Runs the application for a fixed number of frames and writes their statistics to a JSON file
+    // (see "source/benchmarks/compare.cpp" to compare the results of two runs).
+    // Comment:
+    // The benchmark runs the play scene "scene" with the fixed random seed "seed", so every run builds the same world.
+    // The first "warmup-frames" frames are not measured (they include loading the assets, compiling the shaders, filling
+    // the caches, etc.), then "frames" frames are measured. To render the same frames in every run, the states receive a
+    // fixed time step instead of the real frame time, and the camera follows a scripted path (if there is one) instead of
+    // the user input. For every measured frame, the benchmark records the frame time, the CPU time of every system (reported
+    // by the states using "beginSystem" and "endSystem"), the draw calls and triangles drawn by the renderer, and the heap
+    // allocations made by all the threads (see "allocation-tracker.hpp").
+    // If "max-allocations-per-frame" is given, the benchmark fails if a measured frame makes more allocations than that
+    // (a steady-state frame should make none), so a change that adds allocations to the frame is caught by the benchmark run
+    // (the "zero-allocation-race-frames" test of CMake runs the benchmark of "config/app.jsonc" for this).
+    class Benchmark {
+        bool active = false;
+        std::string name, outputPath, scene;
+        std::optional<unsigned int> seed;
+        int warmupFrames = 0, measuredFrames = 0;
+        long long maxAllocationsPerFrame = -1; // Negative if there is no limit
+        double timeStep = 1.0 / 60.0;
+        std::vector<CameraKeyframe> cameraPath;
+
+        int frame = 0;
+        std::vector<float> frameTimes;
+        std::vector<int> drawCalls, triangles;
+        std::vector<float> allocations, allocatedBytes;
+        // The measured frames that made more allocations than the limit, and the first of them.
+        int framesOverAllocationLimit = 0, firstFrameOverAllocationLimit = -1;
+        // The CPU times of every system (one per measured frame) and the time of the current frame.
+        struct SystemTimes {
+            std::string name;
+            std::vector<float> times = {};
+            double current = 0.0;
+        };
+        std::vector<SystemTimes> systems;
+        SystemTimes* runningSystem = nullptr;
+        double systemStart = 0.0;
+        int frameDrawCalls = 0, frameTriangles = 0;
+        AllocationCounts frameAllocations;
+
+        bool isMeasuring() const { return active && frame >= warmupFrames; }
+
+    public:
+        // Reads the benchmark configuration and activates the benchmark:
+        // { "name": "app", "scene": "play-USSR", "seed": 1, "warmup-frames": 120, "frames": 600, "time-step": 0.0166, "output": "benchmarks/app.json", "max-allocations-per-frame": 0,
+        //   "camera-path": [ { "time": 0, "position": [0, 0, 0], "rotation": [0, 0, 0] }, ... ] }
+        void initialize(const nlohmann::json& config);
+
+        bool isActive() const { return active; }
+        // The number of frames to run (warm-up + measured).
+        int getTotalFrames() const { return warmupFrames + measuredFrames; }
+        // The time step that the states should use instead of the real frame time.
+        double getTimeStep() const { return timeStep; }
+        void setOutputPath(const std::string& path) { outputPath = path; }
+        // The state in which the benchmark starts (instead of the "start-scene" of the config), or an empty string if there is none.
+        const std::string& getScene() const { return scene; }
+        // The seed of the random number generator used to build the scene, if the benchmark fixes one.
+        std::optional<unsigned int> getSeed() const { return seed; }
+
+        // Returns the position (relative to the initial camera position) and rotation (in radians) of the camera in
+        // the current frame, or false if there is no camera path.
+        bool sampleCamera(glm::vec3& position, glm::vec3& rotation) const;
+
+        // Measures the CPU time of a system in the current frame. The calls can't be nested.
+        void beginSystem(const char* name);
+        void endSystem();
+        // Records the number of draw calls and triangles drawn in the current frame.
+        void addRenderCounts(int drawCalls, int triangles);
+        // Records the heap allocations made in the current frame.
+        void addAllocations(const AllocationCounts& allocations);
+
+        // Records the duration of the frame (in seconds) and moves to the next frame.
+        void endFrame(double frameTime);
+
+        // Writes the statistics of the measured frames to the output file. Returns false if it couldn't be written.
+        bool write(const std::string& renderer) const;
+
+        // Returns false (and prints the frames that failed) if a measured frame made more allocations than "max-allocations-per-frame".
+        bool checkAllocationLimit() const;
+    };
+
+}
@@ -68,5 +68,6 @@ namespace our {
 
     void CameraComponent::setPosition(glm::vec3 updatedPosition) {
         this->getOwner()->localTransform.position = updatedPosition;
+        this->getOwner()->markTransformChanged();
     }
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ namespace our {
     public:
         Mesh* mesh; // The mesh that should be drawn
         Material* material; // The material used to draw the mesh
+        int lodLevel = 0; // The level of detail of the mesh picked by the renderer in the last frame (see Mesh::lods)
 
         // The ID of this component type is "Mesh Renderer"
         static std::string getID() { return "Mesh Renderer"; }
@@ -1,4 +1,5 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
@@ -29,6 +30,14 @@ namespace our {
         return localToWorldMatrix;
     }
 
+    void Entity::onComponentAdded(Component* component) {
+        if (world) world->onComponentAdded(this, component);
+    }
+
+    void Entity::markTransformChanged() {
+        if (world) world->onTransformChanged(this);
+    }
+
     // Deserializes the entity data and components from a json object
     void Entity::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
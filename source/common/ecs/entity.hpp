@@ -34,11 +34,19 @@ namespace our {
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
+
+        // Notifies the world that a component was added to this entity (see World::onComponentAdded).
+        void onComponentAdded(Component* component);
     public:
         std::string name; // The name of the entity. It could be useful to refer to an entity by its name
         Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
                           // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
+                                  // After the entity is drawn, a change of its transform must be reported with "markTransformChanged".
+
+        // Notifies the world that the transform (or the mesh or material) of this entity changed, so the renderer
+        // updates what it keeps of this entity and its children (see World::changedTransforms).
+        void markTransformChanged();
 
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
 
@@ -56,6 +64,7 @@ namespace our {
             T *newComponent = new T();
             dynamic_cast<Component *>(newComponent)->owner = this;
             this->components.push_back(newComponent);
+            onComponentAdded(newComponent);
 
             return newComponent;
         }
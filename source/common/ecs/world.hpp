@@ -10,6 +10,7 @@
 #include <limits>
 #include <ostream>
 #include <unordered_set>
+#include <vector>
 
 
 namespace our {
@@ -27,9 +28,16 @@ namespace our {
 class World {
   std::unordered_set<Entity *>
       entities; // These are the entities held by this world
-  std::unordered_set<Entity *>
+  std::vector<Entity *>
       markedForRemoval; // These are the entities that are awaiting to be
                         // deleted when deleteMarkedEntities is called
+
+  // Makes sure the given removal list has room for all the entities of the world (doubling its capacity when needed).
+  // An entity is only marked for removal once, while it is in the world, so marking entities for removal never allocates.
+  void reserveRemovals(std::vector<Entity *> &removals) {
+    if (removals.capacity() < removals.size() + entities.size())
+      removals.reserve(2 * (removals.size() + entities.size()));
+  }
 public:
   World() = default;
 
@@ -39,6 +47,36 @@ public:
 
   our::Track track;
 
+  // Comment:
+  // These record the entities that got a renderer component (mesh renderer or multiple meshes renderer),
+  // and the ones holding a renderer component that were marked for removal, since the last time the
+  // renderer synchronized its render proxies with the world (see RenderProxies::synchronize).
+  // An entity that is added then removed before the renderer sees it is simply dropped from "addedRenderables".
+  // The removed ones are kept in a vector (an entity is only removed once), which has room for all the entities
+  // (see "reserveRemovals"), so collecting a coin doesn't allocate.
+  std::unordered_set<Entity *> addedRenderables;
+  std::vector<Entity *> removedRenderables;
+  // The entities whose transform changed since the last synchronization (see Entity::markTransformChanged).
+  // An entity may appear more than once, and it may have been removed since (so the renderer never dereferences them).
+  // It is a vector, which keeps its memory when it is cleared, so marking the moving entities every frame doesn't allocate.
+  std::vector<Entity *> changedTransforms;
+
+  // The first camera added to the world (the renderer draws the world from it), or null if there is none.
+  CameraComponent *camera = nullptr;
+
+  // This is called by the entity when a component is added to it. It records the entity if the component is
+  // a renderer component, and keeps the component if it is the first camera.
+  void onComponentAdded(Entity *entity, Component *component) {
+    if (dynamic_cast<MeshRendererComponent *>(component) || dynamic_cast<MultipleMeshesRendererComponent *>(component)) {
+      addedRenderables.insert(entity);
+    } else if (auto newCamera = dynamic_cast<CameraComponent *>(component); newCamera && !camera) {
+      camera = newCamera;
+    }
+  }
+
+  // This is called by the entity when its transform changes. It records the entity for the renderer.
+  void onTransformChanged(Entity *entity) { changedTransforms.push_back(entity); }
+
   // This will deserialize a json array of entities and add the new entities to
   // the current world If parent pointer is not null, the new entities will be
   // have their parent set to that given pointer If any of the entities has
@@ -60,6 +98,8 @@ public:
     Entity *newEntity = new Entity();
     newEntity->world = this;
     entities.insert(newEntity);
+    reserveRemovals(markedForRemoval);
+    reserveRemovals(removedRenderables);
     return newEntity;
   }
 
@@ -81,7 +121,16 @@ public:
         setOfLights.erase(light);
       }
       
-      markedForRemoval.insert(*it);
+      // If it holds the camera, the world has no camera anymore.
+      if (camera && camera->getOwner() == *it) camera = nullptr;
+
+      // If it is drawn by a renderer component, record its removal (unless the renderer hadn't seen it yet).
+      if (addedRenderables.erase(*it) == 0 &&
+          ((*it)->getComponent<MeshRendererComponent>() || (*it)->getComponent<MultipleMeshesRendererComponent>())) {
+        removedRenderables.push_back(*it);
+      }
+      
+      markedForRemoval.push_back(*it);
       entities.erase(*it);
     }
   }
@@ -105,6 +154,10 @@ public:
     }
     
     entities.clear();
+    addedRenderables.clear();
+    removedRenderables.clear();
+    changedTransforms.clear();
+    camera = nullptr;
     setOfSpaceArtifacts.clear();
     setOfLights.clear();
   }
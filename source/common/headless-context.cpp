@@ -0,0 +1,203 @@
+#include "headless-context.hpp"
+
+#include <dlfcn.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+
+namespace our {
+
+    // The few EGL & OSMesa types and constants that we need (copied from "EGL/egl.h", "EGL/eglext.h" and "GL/osmesa.h").
+    namespace {
+        typedef int32_t EGLint;
+        typedef unsigned int EGLBoolean;
+        typedef unsigned int EGLenum;
+        typedef void* EGLDisplay;
+        typedef void* EGLConfig;
+        typedef void* EGLSurface;
+        typedef void* EGLContext;
+
+        const EGLint EGL_ALPHA_SIZE = 0x3021, EGL_BLUE_SIZE = 0x3022, EGL_GREEN_SIZE = 0x3023, EGL_RED_SIZE = 0x3024;
+        const EGLint EGL_DEPTH_SIZE = 0x3025, EGL_STENCIL_SIZE = 0x3026;
+        const EGLint EGL_SURFACE_TYPE = 0x3033, EGL_PBUFFER_BIT = 0x0001;
+        const EGLint EGL_RENDERABLE_TYPE = 0x3040, EGL_OPENGL_BIT = 0x0008;
+        const EGLint EGL_WIDTH = 0x3057, EGL_HEIGHT = 0x3056;
+        const EGLint EGL_NONE = 0x3038;
+        const EGLenum EGL_OPENGL_API = 0x30A2;
+        const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098, EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+        const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+        const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+        typedef GLADapiproc (*PFN_eglGetProcAddress)(const char*);
+        typedef EGLDisplay (*PFN_eglGetPlatformDisplayEXT)(EGLenum, void*, const EGLint*);
+        typedef EGLDisplay (*PFN_eglGetDisplay)(void*);
+        typedef EGLBoolean (*PFN_eglInitialize)(EGLDisplay, EGLint*, EGLint*);
+        typedef EGLBoolean (*PFN_eglTerminate)(EGLDisplay);
+        typedef EGLBoolean (*PFN_eglChooseConfig)(EGLDisplay, const EGLint*, EGLConfig*, EGLint, EGLint*);
+        typedef EGLBoolean (*PFN_eglBindAPI)(EGLenum);
+        typedef EGLSurface (*PFN_eglCreatePbufferSurface)(EGLDisplay, EGLConfig, const EGLint*);
+        typedef EGLContext (*PFN_eglCreateContext)(EGLDisplay, EGLConfig, EGLContext, const EGLint*);
+        typedef EGLBoolean (*PFN_eglMakeCurrent)(EGLDisplay, EGLSurface, EGLSurface, EGLContext);
+        typedef EGLBoolean (*PFN_eglDestroySurface)(EGLDisplay, EGLSurface);
+        typedef EGLBoolean (*PFN_eglDestroyContext)(EGLDisplay, EGLContext);
+
+        const int OSMESA_FORMAT = 0x22, OSMESA_DEPTH_BITS = 0x30, OSMESA_STENCIL_BITS = 0x31, OSMESA_ACCUM_BITS = 0x32;
+        const int OSMESA_PROFILE = 0x33, OSMESA_CORE_PROFILE = 0x34;
+        const int OSMESA_CONTEXT_MAJOR_VERSION = 0x36, OSMESA_CONTEXT_MINOR_VERSION = 0x37;
+
+        typedef void* (*PFN_OSMesaCreateContextAttribs)(const int*, void*);
+        typedef GLboolean (*PFN_OSMesaMakeCurrent)(void*, void*, GLenum, GLsizei, GLsizei);
+        typedef GLADapiproc (*PFN_OSMesaGetProcAddress)(const char*);
+        typedef void (*PFN_OSMesaDestroyContext)(void*);
+
+        // The function of the current backend that returns the address of an OpenGL function (used by "loadFunction").
+        GLADapiproc (*getProcAddress)(const char*) = nullptr;
+
+        // Opens the first library that exists out of the given names.
+        void* openLibrary(std::initializer_list<const char*> names) {
+            for (const char* name : names)
+                if (void* library = dlopen(name, RTLD_NOW | RTLD_LOCAL)) return library;
+            return nullptr;
+        }
+
+        template<typename T>
+        T findFunction(void* library, const char* name) { return reinterpret_cast<T>(dlsym(library, name)); }
+    }
+
+    GLADapiproc HeadlessContext::loadFunction(const char* name) {
+        return getProcAddress ? getProcAddress(name) : nullptr;
+    }
+
+    bool HeadlessContext::create(glm::ivec2 size) {
+        if (!createEGL(size) && !createOSMesa(size)) {
+            std::cerr << "ERROR: COULDN'T CREATE A HEADLESS OPENGL CONTEXT (NEITHER EGL NOR OSMESA WORKED)." << std::endl;
+            return false;
+        }
+        if (!gladLoadGL(loadFunction)) {
+            std::cerr << "ERROR: COULDN'T LOAD THE OPENGL FUNCTIONS OF THE HEADLESS CONTEXT." << std::endl;
+            destroy();
+            return false;
+        }
+        return true;
+    }
+
+    bool HeadlessContext::createEGL(glm::ivec2 size) {
+        library = openLibrary({"libEGL.so.1", "libEGL.so"});
+        if (!library) return false;
+
+        auto eglGetProcAddress = findFunction<PFN_eglGetProcAddress>(library, "eglGetProcAddress");
+        auto eglGetDisplay = findFunction<PFN_eglGetDisplay>(library, "eglGetDisplay");
+        auto eglInitialize = findFunction<PFN_eglInitialize>(library, "eglInitialize");
+        auto eglChooseConfig = findFunction<PFN_eglChooseConfig>(library, "eglChooseConfig");
+        auto eglBindAPI = findFunction<PFN_eglBindAPI>(library, "eglBindAPI");
+        auto eglCreatePbufferSurface = findFunction<PFN_eglCreatePbufferSurface>(library, "eglCreatePbufferSurface");
+        auto eglCreateContext = findFunction<PFN_eglCreateContext>(library, "eglCreateContext");
+        auto eglMakeCurrent = findFunction<PFN_eglMakeCurrent>(library, "eglMakeCurrent");
+        if (!eglGetProcAddress || !eglGetDisplay || !eglInitialize || !eglChooseConfig || !eglBindAPI ||
+            !eglCreatePbufferSurface || !eglCreateContext || !eglMakeCurrent) {
+            destroy();
+            return false;
+        }
+
+        // The surfaceless platform doesn't need a display server (or a GPU). If it is missing, we try the default display.
+        auto eglGetPlatformDisplayEXT = reinterpret_cast<PFN_eglGetPlatformDisplayEXT>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (eglGetPlatformDisplayEXT) display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+        EGLint major, minor;
+        if (!display || !eglInitialize(display, &major, &minor)) {
+            display = eglGetDisplay(nullptr);
+            if (!display || !eglInitialize(display, &major, &minor)) {
+                display = nullptr;
+                destroy();
+                return false;
+            }
+        }
+
+        const EGLint configAttributes[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+            destroy();
+            return false;
+        }
+
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, size.x, EGL_HEIGHT, size.y, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        const EGLint contextAttributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, nullptr, contextAttributes);
+        if (!surface || !context || !eglMakeCurrent(display, surface, surface, context)) {
+            destroy();
+            return false;
+        }
+
+        getProcAddress = eglGetProcAddress;
+        backend = "EGL";
+        return true;
+    }
+
+    bool HeadlessContext::createOSMesa(glm::ivec2 size) {
+        library = openLibrary({"libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so"});
+        if (!library) return false;
+
+        auto OSMesaCreateContextAttribs = findFunction<PFN_OSMesaCreateContextAttribs>(library, "OSMesaCreateContextAttribs");
+        auto OSMesaMakeCurrent = findFunction<PFN_OSMesaMakeCurrent>(library, "OSMesaMakeCurrent");
+        auto OSMesaGetProcAddress = findFunction<PFN_OSMesaGetProcAddress>(library, "OSMesaGetProcAddress");
+        if (!OSMesaCreateContextAttribs || !OSMesaMakeCurrent || !OSMesaGetProcAddress) {
+            destroy();
+            return false;
+        }
+
+        const int attributes[] = {
+            OSMESA_FORMAT, GL_RGBA,
+            OSMESA_DEPTH_BITS, 24, OSMESA_STENCIL_BITS, 8, OSMESA_ACCUM_BITS, 0,
+            OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+            OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3,
+            0
+        };
+        context = OSMesaCreateContextAttribs(attributes, nullptr);
+        buffer.resize((size_t)size.x * size.y * 4);
+        if (!context || !OSMesaMakeCurrent(context, buffer.data(), GL_UNSIGNED_BYTE, size.x, size.y)) {
+            destroy();
+            return false;
+        }
+
+        getProcAddress = OSMesaGetProcAddress;
+        backend = "OSMesa";
+        return true;
+    }
+
+    void HeadlessContext::destroy() {
+        if (!library) return;
+
+        // The EGL display is only set by the EGL backend, so it tells us which backend created the context.
+        if (display) {
+            auto eglMakeCurrent = findFunction<PFN_eglMakeCurrent>(library, "eglMakeCurrent");
+            auto eglDestroyContext = findFunction<PFN_eglDestroyContext>(library, "eglDestroyContext");
+            auto eglDestroySurface = findFunction<PFN_eglDestroySurface>(library, "eglDestroySurface");
+            auto eglTerminate = findFunction<PFN_eglTerminate>(library, "eglTerminate");
+            eglMakeCurrent(display, nullptr, nullptr, nullptr);
+            if (context) eglDestroyContext(display, context);
+            if (surface) eglDestroySurface(display, surface);
+            eglTerminate(display);
+        } else if (context) {
+            findFunction<PFN_OSMesaDestroyContext>(library, "OSMesaDestroyContext")(context);
+        }
+
+        dlclose(library);
+        library = display = surface = context = nullptr;
+        buffer.clear();
+        backend = nullptr;
+        getProcAddress = nullptr;
+    }
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+namespace our {
+
+    // Creates an OpenGL 3.3 core context without a window (and without a display server), for scripted runs
+    // (benchmarks and batch screenshots) on machines that have no display or GPU, e.g. using Mesa's llvmpipe.
+    // Comment:
+    // Two backends are tried in order:
+    // - EGL on Mesa's surfaceless platform (or the default EGL display if that platform is missing), drawing into a pbuffer.
+    // - OSMesa, drawing into a buffer in the RAM.
+    // In both cases, the offscreen buffer is the default framebuffer of the context (framebuffer 0), so the renderer
+    // and the screenshots work as they do with a window. The libraries are loaded at runtime (using dlopen), so the
+    // application doesn't need them unless it runs in headless mode.
+    class HeadlessContext {
+        void* library = nullptr;
+        const char* backend = nullptr;
+
+        // EGL objects (stored as void* since we don't include the EGL headers).
+        void* display = nullptr;
+        void* surface = nullptr;
+        void* context = nullptr;
+
+        // The buffer that OSMesa draws into.
+        std::vector<unsigned char> buffer;
+
+        bool createEGL(glm::ivec2 size);
+        bool createOSMesa(glm::ivec2 size);
+
+        // The function used by glad to find the OpenGL functions of the current backend.
+        static GLADapiproc loadFunction(const char* name);
+
+    public:
+        // Creates a context with a default framebuffer of the given size and makes it current, then loads the OpenGL functions.
+        // Returns false if no backend works.
+        bool create(glm::ivec2 size);
+        // Destroys the context and unloads the library.
+        void destroy();
+
+        // Returns the name of the backend in use ("EGL" or "OSMesa"), or nullptr if there is no context.
+        const char* getBackend() const { return backend; }
+
+        ~HeadlessContext() { destroy(); }
+    };
+
+}
@@ -0,0 +1,159 @@
+#include "input-recording.hpp"
+#include "../our-util.hpp"
+
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+namespace our {
+
+    static const char RECORDING_MAGIC[4] = {'S', 'R', 'I', 'R'};
+    static const uint32_t RECORDING_VERSION = 1;
+
+    // Appends the bytes of a value to the buffer (in the byte order of the machine).
+    template<typename T>
+    static void write(std::vector<uint8_t>& buffer, T value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    // Reads a value from the data at the given offset and moves the offset after it. Returns false if the data ended.
+    template<typename T>
+    static bool read(const std::vector<uint8_t>& data, size_t& offset, T& value) {
+        if (offset + sizeof(T) > data.size()) return false;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool InputRecorder::open(const std::string& path, uint32_t seed, glm::vec2 cursorPosition) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "ERROR: COULDN'T CREATE THE INPUT RECORDING: " << path << std::endl;
+            return false;
+        }
+        buffer.clear();
+        buffer.insert(buffer.end(), RECORDING_MAGIC, RECORDING_MAGIC + 4);
+        write(buffer, RECORDING_VERSION);
+        write(buffer, seed);
+        write(buffer, (double)cursorPosition.x);
+        write(buffer, (double)cursorPosition.y);
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        buffer.clear();
+        frame = 0;
+        return true;
+    }
+
+    void InputRecorder::record(const InputEvent& event) {
+        if (!isRecording()) return;
+        write(buffer, (uint8_t)event.type);
+        write(buffer, frame);
+        write(buffer, (float)getTime());
+        switch (event.type) {
+            case InputEventType::KEY:
+                write(buffer, (int16_t)event.code);
+                write(buffer, (int16_t)event.scancode);
+                write(buffer, (int8_t)event.action);
+                write(buffer, (int8_t)event.mods);
+                break;
+            case InputEventType::MOUSE_BUTTON:
+                write(buffer, (int8_t)event.code);
+                write(buffer, (int8_t)event.action);
+                write(buffer, (int8_t)event.mods);
+                break;
+            case InputEventType::CURSOR_MOVE:
+            case InputEventType::SCROLL:
+                write(buffer, event.x);
+                write(buffer, event.y);
+                break;
+            case InputEventType::CURSOR_ENTER:
+                write(buffer, (int8_t)event.code);
+                break;
+            case InputEventType::FRAME:
+                write(buffer, event.deltaTime);
+                break;
+        }
+    }
+
+    void InputRecorder::endFrame(double deltaTime) {
+        if (!isRecording()) return;
+        InputEvent event;
+        event.type = InputEventType::FRAME;
+        event.deltaTime = deltaTime;
+        record(event);
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        buffer.clear();
+        frame++;
+    }
+
+    void InputRecorder::close() {
+        if (isRecording()) file.close();
+    }
+
+    bool InputReplayer::open(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "ERROR: COULDN'T OPEN THE INPUT RECORDING: " << path << std::endl;
+            return false;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        size_t offset = 4;
+        uint32_t version = 0;
+        double cursorX = 0.0, cursorY = 0.0;
+        if (data.size() < 4 || std::memcmp(data.data(), RECORDING_MAGIC, 4) != 0 || !read(data, offset, version) ||
+            version != RECORDING_VERSION || !read(data, offset, seed) || !read(data, offset, cursorX) || !read(data, offset, cursorY)) {
+            std::cerr << "ERROR: NOT A VALID INPUT RECORDING: " << path << std::endl;
+            return false;
+        }
+        cursorPosition = glm::vec2((float)cursorX, (float)cursorY);
+
+        events.clear();
+        while (offset < data.size()) {
+            InputEvent event;
+            uint8_t type;
+            bool complete = read(data, offset, type) && read(data, offset, event.frame) && read(data, offset, event.time);
+            event.type = (InputEventType)type;
+            int16_t key = 0, scancode = 0;
+            int8_t code = 0, action = 0, mods = 0;
+            switch (event.type) {
+                case InputEventType::KEY:
+                    complete = complete && read(data, offset, key) && read(data, offset, scancode) && read(data, offset, action) && read(data, offset, mods);
+                    event.code = key;
+                    event.scancode = scancode;
+                    break;
+                case InputEventType::MOUSE_BUTTON:
+                    complete = complete && read(data, offset, code) && read(data, offset, action) && read(data, offset, mods);
+                    event.code = code;
+                    break;
+                case InputEventType::CURSOR_MOVE:
+                case InputEventType::SCROLL:
+                    complete = complete && read(data, offset, event.x) && read(data, offset, event.y);
+                    break;
+                case InputEventType::CURSOR_ENTER:
+                    complete = complete && read(data, offset, code);
+                    event.code = code;
+                    break;
+                case InputEventType::FRAME:
+                    complete = complete && read(data, offset, event.deltaTime);
+                    break;
+                default:
+                    complete = false;
+            }
+            // A recording that was cut (e.g. the application crashed) is replayed up to its last complete event.
+            if (!complete) {
+                std::cerr << "WARNING: THE INPUT RECORDING ENDS WITH AN INCOMPLETE EVENT: " << path << std::endl;
+                break;
+            }
+            event.action = action;
+            event.mods = mods;
+            events.push_back(event);
+        }
+
+        nextEvent = 0;
+        replaying = true;
+        return true;
+    }
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    enum class InputEventType : uint8_t {
+        KEY,
+        MOUSE_BUTTON,
+        CURSOR_MOVE,
+        CURSOR_ENTER,
+        SCROLL,
+        FRAME // Marks the end of a frame and holds the delta time that the frame used
+    };
+
+    // An input event received from GLFW (or from a replayed recording), or the end of a frame.
+    struct InputEvent {
+        InputEventType type = InputEventType::FRAME;
+        uint32_t frame = 0;    // The frame in which the event was received
+        float time = 0.0f;     // The time at which the event was received (see "our::getTime")
+        int code = 0;          // The key (KEY), the button (MOUSE_BUTTON) or whether the cursor entered (CURSOR_ENTER)
+        int scancode = 0, action = 0, mods = 0; // The rest of the parameters of KEY and MOUSE_BUTTON
+        double x = 0.0, y = 0.0; // The position (CURSOR_MOVE) or the offset (SCROLL)
+        double deltaTime = 0.0;  // The delta time of the frame (FRAME)
+    };
+
+    // Comment:
+    // A recording is a binary file that starts with a header:
+    //   "SRIR" (4 bytes), the version (uint32), the seed of the random number generator (uint32), the initial cursor position (2 doubles),
+    // then the events in the order they were received. Every event starts with its type (uint8), its frame (uint32) and its time (float),
+    // followed by its parameters: a KEY has the key & scancode (int16 each), the action & mods (int8 each); a MOUSE_BUTTON has the button,
+    // action & mods (int8 each); a CURSOR_MOVE or a SCROLL has two doubles; a CURSOR_ENTER has an int8; and a FRAME has its delta time (double).
+    // Every frame ends with a FRAME event, so a replayer knows which events to inject before every frame.
+
+    // Writes the input events received by the application to a recording.
+    class InputRecorder {
+        std::ofstream file;
+        std::vector<uint8_t> buffer; // The events of the current frame (written to the file at the end of the frame)
+        uint32_t frame = 0;
+
+    public:
+        // Creates the recording file and writes its header. Returns false if the file couldn't be created.
+        bool open(const std::string& path, uint32_t seed, glm::vec2 cursorPosition);
+        bool isRecording() const { return file.is_open(); }
+
+        // Adds an event to the current frame (the frame & time of the event are filled by the recorder).
+        void record(const InputEvent& event);
+        // Ends the current frame with the given delta time.
+        void endFrame(double deltaTime);
+
+        void close();
+        ~InputRecorder() { close(); }
+    };
+
+    // Reads a recording and returns its events in order, so they can be injected instead of the GLFW events.
+    class InputReplayer {
+        std::vector<InputEvent> events;
+        size_t nextEvent = 0;
+        bool replaying = false;
+        uint32_t seed = 0;
+        glm::vec2 cursorPosition = glm::vec2(0.0f);
+
+    public:
+        // Reads the whole recording. Returns false if it couldn't be read or is not a valid recording.
+        bool open(const std::string& path);
+        bool isReplaying() const { return replaying; }
+
+        uint32_t getSeed() const { return seed; }
+        glm::vec2 getCursorPosition() const { return cursorPosition; }
+
+        // Returns the next event (ending every frame with a FRAME event), or nullptr if the recording ended.
+        const InputEvent* next() { return nextEvent < events.size() ? &events[nextEvent++] : nullptr; }
+    };
+
+}
@@ -14,15 +14,17 @@ namespace our {
 
     public:
         // Enable this object and capture current keyboard state from window
+        // (If there is no window, e.g. when replaying recorded input, no key is pressed).
         void enable(GLFWwindow* window){
             enabled = true;
             for(int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++){
-                currentKeyStates[key] = previousKeyStates[key] = glfwGetKey(window, key);
+                currentKeyStates[key] = previousKeyStates[key] = window && glfwGetKey(window, key);
             }
         }
 
         // Disable this object and clear the state
         void disable(){
+            enabled = false;
             for(int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++){
                 currentKeyStates[key] = previousKeyStates[key] = false;
             }
@@ -16,13 +16,14 @@ namespace our {
 
     public:
         // Enable this object and capture current mouse state from window
+        // (If there is no window, e.g. when replaying recorded input, the cursor is at (0, 0) and no button is pressed).
         void enable(GLFWwindow *window) {
             enabled = true;
-            double x, y;
-            glfwGetCursorPos(window, &x, &y);
+            double x = 0, y = 0;
+            if (window) glfwGetCursorPos(window, &x, &y);
             previousMousePosition = currentMousePosition = glm::vec2((float) x, (float) y);
             for (int button = 0; button <= GLFW_MOUSE_BUTTON_LAST; button++) {
-                currentMouseButtons[button] = previousMouseButtons[button] = glfwGetMouseButton(window, button);
+                currentMouseButtons[button] = previousMouseButtons[button] = window && glfwGetMouseButton(window, button);
             }
             scrollOffset = glm::vec2(); // (0, 0)
         }
@@ -46,6 +47,8 @@ namespace our {
 
         // Current Mouse Position
         [[nodiscard]] const glm::vec2& getMousePosition() const { return currentMousePosition; }
+        // Moves the mouse to the given position without moving it since the last frame (used to start replaying recorded input).
+        void setPosition(glm::vec2 position) { previousMousePosition = currentMousePosition = position; }
 
         // How much the mouse moved since the last frame
         [[nodiscard]] glm::vec2 getMouseDelta() const { return currentMousePosition - previousMousePosition; }
@@ -82,9 +85,9 @@ namespace our {
         }
 
         // Locks the mouse position and hides it (Usually used for FPS games)
-        static void lockMouse(GLFWwindow *window) { glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); }
+        static void lockMouse(GLFWwindow *window) { if (window) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); }
         // If the mouse was locked, unlock it (make it visible and allow it to move)
-        static void unlockMouse(GLFWwindow *window) { glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); }
+        static void unlockMouse(GLFWwindow *window) { if (window) glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); }
 
 
         [[nodiscard]] bool isEnabled() const { return enabled; }
@@ -147,6 +147,15 @@ namespace our {
         sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
     }
 
+    // This function updates the current frame if a certain duration has passed since the last change.
+    void TexturedGIFMaterial::updateFrame(double time) {
+        if (time - lastFrameTimeChange >= durationPerFrame) {
+            lastFrameTimeChange = time;
+            // We update the current frame, and wrap around if we reached the final frame. 
+            currentFrame = (currentFrame == gif->textures.size()-1) ? 0 : currentFrame+1;
+        }
+    }
+
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture to the current frame in the gif,
@@ -81,6 +81,10 @@ namespace our {
         float lastFrameTimeChange = 0.0; // The last time the frame has changed
         float durationPerFrame; // The duration for each frame.
 
+        // Moves to the next frame (wrapping around after the final one) if "durationPerFrame" has passed
+        // since the last change. "time" is the current time in seconds.
+        void updateFrame(double time);
+
         void setup() const override;
         void deserialize(const nlohmann::json& data) override;
     };
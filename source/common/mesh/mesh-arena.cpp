@@ -0,0 +1,187 @@
+#include "mesh-arena.hpp"
+#include "mesh.hpp"
+#include "../metrics.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+namespace our {
+
+    // The initial capacities of the arena buffers (they double whenever they are full).
+    static const size_t INITIAL_VERTEX_CAPACITY = 1 << 16;
+    static const size_t INITIAL_ELEMENT_CAPACITY = 1 << 18;
+
+    bool RangeAllocator::allocate(size_t count, size_t& offset) {
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+            if (it->second < count) continue;
+            offset = it->first;
+            size_t remaining = it->second - count;
+            freeRanges.erase(it);
+            if (remaining > 0) freeRanges[offset + count] = remaining;
+            return true;
+        }
+        return false;
+    }
+
+    void RangeAllocator::release(size_t offset, size_t count) {
+        if (count == 0) return;
+        auto it = freeRanges.emplace(offset, count).first;
+        // Merge with the next free range.
+        if (auto next = std::next(it); next != freeRanges.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeRanges.erase(next);
+        }
+        // Merge with the previous free range.
+        if (it != freeRanges.begin()) {
+            auto previous = std::prev(it);
+            if (previous->first + previous->second == it->first) {
+                previous->second += it->second;
+                freeRanges.erase(it);
+            }
+        }
+    }
+
+    void RangeAllocator::grow(size_t newCapacity) {
+        if (newCapacity <= capacity) return;
+        size_t oldCapacity = capacity;
+        capacity = newCapacity;
+        release(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    size_t RangeAllocator::freeAtEnd() const {
+        if (freeRanges.empty()) return 0;
+        auto last = std::prev(freeRanges.end());
+        return last->first + last->second == capacity ? last->second : 0;
+    }
+
+    MeshArena& MeshArena::get() {
+        static MeshArena arena;
+        return arena;
+    }
+
+    void MeshArena::create() {
+        glGenVertexArrays(1, &vertexArray);
+        vertexBuffer = resize(0, 0, INITIAL_VERTEX_CAPACITY * sizeof(Vertex));
+        elementBuffer = resize(0, 0, INITIAL_ELEMENT_CAPACITY * sizeof(unsigned int));
+        vertices.grow(INITIAL_VERTEX_CAPACITY);
+        elements.grow(INITIAL_ELEMENT_CAPACITY);
+        setupVertexArray();
+    }
+
+    void MeshArena::destroy() {
+        glDeleteVertexArrays(1, &vertexArray);
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &elementBuffer);
+        vertexArray = vertexBuffer = elementBuffer = 0;
+        instanceBuffer = 0;
+        vertices.reset();
+        elements.reset();
+    }
+
+    GLuint MeshArena::resize(GLuint buffer, size_t used, size_t capacity) {
+        // Comment:
+        // The buffers are bound to the copy targets while copying, so the bindings of the current
+        // vertex array (e.g. its element buffer) are not touched.
+        GLuint newBuffer;
+        glGenBuffers(1, &newBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+        if (buffer) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            if (used > 0) glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return newBuffer;
+    }
+
+    void MeshArena::setupVertexArray() {
+        glBindVertexArray(vertexArray);
+
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+
+            glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
+            glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+
+            glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
+            glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+
+            glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
+            glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, tex_coord));
+
+            glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
+            glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+
+        glBindVertexArray(0);
+    }
+
+    void MeshArena::allocate(const std::vector<Vertex>& vertexData, const std::vector<unsigned int>& elementData,
+                             ArenaRange& vertexRange, ArenaRange& elementRange) {
+        if (!vertexArray) create();
+
+        // Comment:
+        // If a range doesn't fit, the buffer grows (at least doubling) such that the free space at its end fits it.
+        // Only the part of the old buffer before that free space holds data, so only that part is copied.
+        auto reserve = [](RangeAllocator& allocator, GLuint& buffer, size_t count, size_t stride, ArenaRange& range) {
+            range.count = count;
+            if (allocator.allocate(count, range.offset)) return;
+            size_t used = allocator.getCapacity() - allocator.freeAtEnd();
+            size_t capacity = std::max(allocator.getCapacity() * 2, used + count);
+            buffer = resize(buffer, used * stride, capacity * stride);
+            allocator.grow(capacity);
+            allocator.allocate(count, range.offset);
+        };
+        GLuint oldVertexBuffer = vertexBuffer, oldElementBuffer = elementBuffer;
+        reserve(vertices, vertexBuffer, vertexData.size(), sizeof(Vertex), vertexRange);
+        reserve(elements, elementBuffer, elementData.size(), sizeof(unsigned int), elementRange);
+        if (vertexBuffer != oldVertexBuffer || elementBuffer != oldElementBuffer) setupVertexArray();
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexRange.offset * sizeof(Vertex), vertexData.size() * sizeof(Vertex), vertexData.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, elementBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, elementRange.offset * sizeof(unsigned int), elementData.size() * sizeof(unsigned int), elementData.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        metrics::bytesUploaded.add((int64_t)(vertexData.size() * sizeof(Vertex) + elementData.size() * sizeof(unsigned int)));
+        liveRanges++;
+    }
+
+    void MeshArena::release(const ArenaRange& vertexRange, const ArenaRange& elementRange) {
+        vertices.release(vertexRange.offset, vertexRange.count);
+        elements.release(elementRange.offset, elementRange.count);
+        if (--liveRanges == 0) destroy();
+    }
+
+    void MeshArena::read(const ArenaRange& vertexRange, const ArenaRange& elementRange,
+                         std::vector<Vertex>& vertexData, std::vector<unsigned int>& elementData) const {
+        vertexData.resize(vertexRange.count);
+        elementData.resize(elementRange.count);
+        glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, vertexRange.offset * sizeof(Vertex), vertexData.size() * sizeof(Vertex), vertexData.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, elementBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, elementRange.offset * sizeof(unsigned int), elementData.size() * sizeof(unsigned int), elementData.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    void MeshArena::bindInstanceBuffer(GLuint buffer) {
+        if (buffer == instanceBuffer) return;
+        glBindVertexArray(vertexArray);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (int column = 0; column < 4; column++) {
+            GLuint location = ATTRIB_LOC_INSTANCE_MODEL + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, model) + sizeof(glm::vec4) * column));
+            glVertexAttribDivisor(location, 1);
+        }
+        for (int column = 0; column < 3; column++) {
+            GLuint location = ATTRIB_LOC_INSTANCE_NORMAL + column;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void *)(offsetof(InstanceData, normalMatrix) + sizeof(glm::vec3) * column));
+            glVertexAttribDivisor(location, 1);
+        }
+        instanceBuffer = buffer;
+    }
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/gl.h>
+#include "vertex.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace our {
+
+    // A range inside one of the arena buffers (in vertices or in indices).
+    struct ArenaRange {
+        size_t offset = 0;
+        size_t count = 0;
+    };
+
+    // Keeps track of the free ranges of a buffer that is split between many owners.
+    // The free ranges are kept sorted by offset, and adjacent free ranges are merged when a range is released.
+    class RangeAllocator {
+        std::map<size_t, size_t> freeRanges; // offset -> count
+        size_t capacity = 0;
+    public:
+        // Returns the offset of a free range of the given size (the first one that fits), or false if none fits.
+        bool allocate(size_t count, size_t& offset);
+        // Returns a range to the free ranges.
+        void release(size_t offset, size_t count);
+        // Adds the space between the old and the new capacity to the free ranges.
+        void grow(size_t newCapacity);
+        // Returns the size of the free range at the end of the buffer (0 if the last element is used).
+        size_t freeAtEnd() const;
+        size_t getCapacity() const { return capacity; }
+        void reset() { freeRanges.clear(); capacity = 0; }
+    };
+
+    // The mesh arena holds the vertices and elements of all the meshes in one large vertex buffer and one
+    // large element buffer, read through a single vertex array. Every mesh is a range of vertices (drawn with
+    // its first vertex as the base vertex) and a range of elements, so drawing any mesh only needs this arena's
+    // vertex array, and the driver manages two large buffers instead of two small buffers per mesh.
+    // There is an arena per vertex format; since all our meshes use "Vertex", there is only one (see "get").
+    // Comment:
+    // When a buffer is full, a buffer twice as large is created and the old content is copied to it on the GPU
+    // (the ranges keep their offsets). When the last mesh is released, the OpenGL objects are deleted, so the
+    // arena doesn't outlive the assets (which are cleared before the OpenGL context is destroyed).
+    class MeshArena {
+        GLuint vertexBuffer = 0, elementBuffer = 0;
+        GLuint vertexArray = 0;
+        RangeAllocator vertices, elements;
+        // The number of allocated ranges. When it goes back to zero, the OpenGL objects are deleted.
+        size_t liveRanges = 0;
+        // The instance buffer that the per-instance attributes of the vertex array currently read from (0 if none).
+        GLuint instanceBuffer = 0;
+
+        void create();
+        void destroy();
+        // Reallocates the given buffer with the given capacity (in bytes), keeping the first "used" bytes of its content.
+        static GLuint resize(GLuint buffer, size_t used, size_t capacity);
+        void setupVertexArray();
+
+    public:
+        // Returns the arena of the "Vertex" format.
+        static MeshArena& get();
+
+        // Uploads the given vertices and elements to the arena and returns their ranges.
+        void allocate(const std::vector<Vertex>& vertexData, const std::vector<unsigned int>& elementData,
+                      ArenaRange& vertexRange, ArenaRange& elementRange);
+        // Releases the ranges of a mesh.
+        void release(const ArenaRange& vertexRange, const ArenaRange& elementRange);
+
+        // Reads back the content of the given ranges (the elements are returned relative to the first vertex of their mesh).
+        void read(const ArenaRange& vertexRange, const ArenaRange& elementRange,
+                  std::vector<Vertex>& vertexData, std::vector<unsigned int>& elementData) const;
+
+        // Binds the vertex array of the arena.
+        void bind() const { glBindVertexArray(vertexArray); }
+        // Makes the per-instance attributes (see InstanceData in "mesh.hpp") read from the given buffer.
+        // This is only done when the buffer changes.
+        void bindInstanceBuffer(GLuint buffer);
+
+        GLuint getVertexBuffer() const { return vertexBuffer; }
+        GLuint getElementBuffer() const { return elementBuffer; }
+        GLuint getVertexArray() const { return vertexArray; }
+    };
+
+}
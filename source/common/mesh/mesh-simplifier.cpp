@@ -0,0 +1,311 @@
+#include "mesh-utils.hpp"
+
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <limits>
+
+// This file implements mesh simplification using the quadric error metric (QEM) by Garland and Heckbert.
+// The main idea is that every vertex gets a quadric (a symmetric 4x4 matrix) that sums the squared distances
+// to the planes of the triangles around it. Then, the edges are collapsed one by one, starting from the edge
+// whose collapse adds the least error, until the target triangle count or the maximum error is reached.
+// We use "half-edge collapses" where one end of the edge is moved onto the other, so no new vertices are created
+// and the texture coordinates and normals of the remaining vertices are kept as they are.
+
+namespace {
+
+    // A symmetric 4x4 matrix stored as its upper triangle (10 values).
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double          a11 = 0, a12 = 0, a13 = 0;
+        double                   a22 = 0, a23 = 0;
+        double                            a33 = 0;
+
+        // The quadric of the plane dot(normal, p) + d = 0 multiplied by the given weight
+        static Quadric fromPlane(glm::dvec3 normal, double d, double weight) {
+            Quadric q;
+            q.a00 = weight * normal.x * normal.x; q.a01 = weight * normal.x * normal.y; q.a02 = weight * normal.x * normal.z; q.a03 = weight * normal.x * d;
+            q.a11 = weight * normal.y * normal.y; q.a12 = weight * normal.y * normal.z; q.a13 = weight * normal.y * d;
+            q.a22 = weight * normal.z * normal.z; q.a23 = weight * normal.z * d;
+            q.a33 = weight * d * d;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            return *this;
+        }
+
+        // Computes transpose(p) * Q * p where p = (x, y, z, 1), which is the sum of the (weighted) squared distances to the planes.
+        double evaluate(glm::dvec3 p) const {
+            return a00 * p.x * p.x + 2 * a01 * p.x * p.y + 2 * a02 * p.x * p.z + 2 * a03 * p.x
+                 + a11 * p.y * p.y + 2 * a12 * p.y * p.z + 2 * a13 * p.y
+                 + a22 * p.z * p.z + 2 * a23 * p.z
+                 + a33;
+        }
+    };
+
+    // A candidate collapse in the priority queue. It is only valid if the versions of both ends did not change since it was pushed.
+    struct Collapse {
+        double cost;
+        int from, to;
+        unsigned int fromVersion, toVersion;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    struct Simplifier {
+        // The attribute vertices, and the position (after merging the vertices with the same position) of each one of them.
+        const std::vector<our::Vertex>& vertices;
+        std::vector<int> positionOf;
+        std::vector<glm::dvec3> positions;
+        // The attribute vertices sharing each position.
+        std::vector<std::vector<GLuint>> verticesAt;
+
+        // The triangles (as attribute vertex indices), whether they are still alive, and the triangles around every position.
+        std::vector<GLuint> triangles;
+        std::vector<bool> triangleAlive;
+        std::vector<std::vector<int>> trianglesAt;
+        int aliveTriangles = 0;
+
+        std::vector<Quadric> quadrics;
+        std::vector<bool> positionAlive;
+        std::vector<unsigned int> versions;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+        Simplifier(const std::vector<our::Vertex>& vertices, const std::vector<GLuint>& elements) : vertices(vertices) {
+
+            // Merge the vertices that have the same position. The OBJ loader splits them whenever the
+            // texture coordinates or the normals differ, but they should move together while simplifying.
+            std::unordered_map<glm::vec3, int> positionMap;
+            positionOf.resize(vertices.size());
+            for (size_t index = 0; index < vertices.size(); index++) {
+                auto [it, inserted] = positionMap.try_emplace(vertices[index].position, (int)positions.size());
+                if (inserted) {
+                    positions.push_back(glm::dvec3(vertices[index].position));
+                    verticesAt.emplace_back();
+                }
+                positionOf[index] = it->second;
+                verticesAt[it->second].push_back((GLuint)index);
+            }
+
+            // Keep only the triangles that are not degenerate after merging the positions.
+            trianglesAt.resize(positions.size());
+            for (size_t index = 0; index + 2 < elements.size(); index += 3) {
+                int p0 = positionOf[elements[index]], p1 = positionOf[elements[index + 1]], p2 = positionOf[elements[index + 2]];
+                if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+                int triangle = (int)(triangles.size() / 3);
+                triangles.insert(triangles.end(), {elements[index], elements[index + 1], elements[index + 2]});
+                trianglesAt[p0].push_back(triangle);
+                trianglesAt[p1].push_back(triangle);
+                trianglesAt[p2].push_back(triangle);
+            }
+            aliveTriangles = (int)(triangles.size() / 3);
+            triangleAlive.assign(aliveTriangles, true);
+            positionAlive.assign(positions.size(), true);
+            versions.assign(positions.size(), 0);
+
+            computeQuadrics();
+        }
+
+        // A key that identifies the (undirected) edge between two positions.
+        static uint64_t edgeKey(int a, int b) {
+            return ((uint64_t)std::min(a, b) << 32) | (uint32_t)std::max(a, b);
+        }
+
+        glm::dvec3 trianglePosition(int triangle, int corner) const {
+            return positions[positionOf[triangles[3 * triangle + corner]]];
+        }
+
+        void computeQuadrics() {
+            quadrics.assign(positions.size(), Quadric());
+
+            // Every triangle adds its plane to the quadrics of its corners. The planes are not weighted by the triangle areas
+            // so that the cost of a collapse stays a sum of squared distances, which we can compare with the error target.
+            // We also count how many triangles share every edge to find the border edges.
+            std::unordered_map<uint64_t, int> edgeTriangleCount;
+            for (int triangle = 0; triangle < (int)triangleAlive.size(); triangle++) {
+                glm::dvec3 p0 = trianglePosition(triangle, 0), p1 = trianglePosition(triangle, 1), p2 = trianglePosition(triangle, 2);
+                glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+                double doubleArea = glm::length(normal);
+                if (doubleArea <= 0.0) continue;
+                normal /= doubleArea;
+                Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, p0), 1.0);
+                for (int corner = 0; corner < 3; corner++) {
+                    int position = positionOf[triangles[3 * triangle + corner]];
+                    quadrics[position] += quadric;
+                    edgeTriangleCount[edgeKey(position, positionOf[triangles[3 * triangle + (corner + 1) % 3]])]++;
+                }
+            }
+
+            // The border edges get an extra plane that is perpendicular to their triangle, so that
+            // moving their ends away from the border is penalized (this keeps the silhouette of open meshes).
+            const double borderWeight = 10.0;
+            for (int triangle = 0; triangle < (int)triangleAlive.size(); triangle++) {
+                glm::dvec3 p0 = trianglePosition(triangle, 0), p1 = trianglePosition(triangle, 1), p2 = trianglePosition(triangle, 2);
+                glm::dvec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+                if (glm::length(faceNormal) <= 0.0) continue;
+                for (int corner = 0; corner < 3; corner++) {
+                    int a = positionOf[triangles[3 * triangle + corner]], b = positionOf[triangles[3 * triangle + (corner + 1) % 3]];
+                    if (edgeTriangleCount[edgeKey(a, b)] != 1) continue;
+                    glm::dvec3 edge = positions[b] - positions[a];
+                    glm::dvec3 normal = glm::cross(edge, faceNormal);
+                    double length = glm::length(normal);
+                    if (length <= 0.0) continue;
+                    normal /= length;
+                    Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, positions[a]), borderWeight);
+                    quadrics[a] += quadric;
+                    quadrics[b] += quadric;
+                }
+            }
+        }
+
+        // Pushes the cheapest direction of collapsing the edge between the two positions.
+        void pushEdge(int a, int b) {
+            Quadric sum = quadrics[a];
+            sum += quadrics[b];
+            double costAB = sum.evaluate(positions[b]), costBA = sum.evaluate(positions[a]);
+            if (costAB <= costBA) queue.push({costAB, a, b, versions[a], versions[b]});
+            else queue.push({costBA, b, a, versions[b], versions[a]});
+        }
+
+        void pushAllEdges() {
+            std::unordered_set<uint64_t> pushed;
+            for (int triangle = 0; triangle < (int)triangleAlive.size(); triangle++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    int a = positionOf[triangles[3 * triangle + corner]], b = positionOf[triangles[3 * triangle + (corner + 1) % 3]];
+                    // Interior edges are shared by two triangles, so we make sure every edge is pushed once.
+                    if (pushed.insert(edgeKey(a, b)).second) pushEdge(a, b);
+                }
+            }
+        }
+
+        // Returns true if moving "from" onto "to" flips or collapses any of the triangles that remain after the collapse.
+        bool collapseFlipsTriangles(int from, int to) const {
+            for (int triangle : trianglesAt[from]) {
+                if (!triangleAlive[triangle]) continue;
+                glm::dvec3 corners[3];
+                bool containsTo = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    int position = positionOf[triangles[3 * triangle + corner]];
+                    if (position == to) containsTo = true;
+                    corners[corner] = positions[position];
+                }
+                if (containsTo) continue; // This triangle will be removed.
+
+                glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                for (int corner = 0; corner < 3; corner++) {
+                    if (positionOf[triangles[3 * triangle + corner]] == from) corners[corner] = positions[to];
+                }
+                glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                double beforeLength = glm::length(before), afterLength = glm::length(after);
+                if (afterLength <= 1e-12 * (beforeLength + 1e-30)) return true;
+                if (glm::dot(before, after) < 0.2 * beforeLength * afterLength) return true;
+            }
+            return false;
+        }
+
+        // Picks the attribute vertex at "to" that is the most similar to the given one (in texture coordinates and normal).
+        GLuint closestVertexAt(int to, GLuint vertex) const {
+            GLuint best = verticesAt[to][0];
+            float bestDistance = std::numeric_limits<float>::max();
+            for (GLuint candidate : verticesAt[to]) {
+                glm::vec2 uvDifference = vertices[candidate].tex_coord - vertices[vertex].tex_coord;
+                glm::vec3 normalDifference = vertices[candidate].normal - vertices[vertex].normal;
+                float distance = glm::dot(uvDifference, uvDifference) + glm::dot(normalDifference, normalDifference);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = candidate;
+                }
+            }
+            return best;
+        }
+
+        void collapse(int from, int to) {
+            std::unordered_map<GLuint, GLuint> replacements;
+            for (GLuint vertex : verticesAt[from]) replacements[vertex] = closestVertexAt(to, vertex);
+
+            for (int triangle : trianglesAt[from]) {
+                if (!triangleAlive[triangle]) continue;
+                bool containsTo = false;
+                for (int corner = 0; corner < 3; corner++) {
+                    if (positionOf[triangles[3 * triangle + corner]] == to) containsTo = true;
+                }
+                if (containsTo) {
+                    triangleAlive[triangle] = false;
+                    aliveTriangles--;
+                    continue;
+                }
+                for (int corner = 0; corner < 3; corner++) {
+                    GLuint& vertex = triangles[3 * triangle + corner];
+                    if (positionOf[vertex] == from) vertex = replacements[vertex];
+                }
+                trianglesAt[to].push_back(triangle);
+            }
+
+            quadrics[to] += quadrics[from];
+            positionAlive[from] = false;
+            trianglesAt[from].clear();
+            verticesAt[from].clear();
+            versions[to]++;
+
+            // Remove the dead triangles from the list of "to", then push the updated edges around it.
+            auto& around = trianglesAt[to];
+            around.erase(std::remove_if(around.begin(), around.end(), [this](int triangle){ return !triangleAlive[triangle]; }), around.end());
+            std::sort(around.begin(), around.end());
+            around.erase(std::unique(around.begin(), around.end()), around.end());
+            for (int triangle : around) {
+                for (int corner = 0; corner < 3; corner++) {
+                    int position = positionOf[triangles[3 * triangle + corner]];
+                    if (position != to) pushEdge(to, position);
+                }
+            }
+        }
+
+        // Collapses edges until the number of triangles reaches "targetTriangles" or the cheapest collapse costs more than "maxError".
+        void run(int targetTriangles, double maxError) {
+            pushAllEdges();
+            while (aliveTriangles > targetTriangles && !queue.empty()) {
+                Collapse candidate = queue.top();
+                queue.pop();
+                if (candidate.cost > maxError) break;
+                if (!positionAlive[candidate.from] || !positionAlive[candidate.to]) continue;
+                if (versions[candidate.from] != candidate.fromVersion || versions[candidate.to] != candidate.toVersion) continue;
+                if (collapseFlipsTriangles(candidate.from, candidate.to)) continue;
+                collapse(candidate.from, candidate.to);
+            }
+        }
+
+        // Writes the remaining triangles (and only the vertices they use) to the output vectors.
+        void output(std::vector<our::Vertex>& outVertices, std::vector<GLuint>& outElements) const {
+            std::vector<GLuint> remap(vertices.size(), std::numeric_limits<GLuint>::max());
+            outVertices.clear();
+            outElements.clear();
+            for (int triangle = 0; triangle < (int)triangleAlive.size(); triangle++) {
+                if (!triangleAlive[triangle]) continue;
+                for (int corner = 0; corner < 3; corner++) {
+                    GLuint vertex = triangles[3 * triangle + corner];
+                    if (remap[vertex] == std::numeric_limits<GLuint>::max()) {
+                        remap[vertex] = (GLuint)outVertices.size();
+                        outVertices.push_back(vertices[vertex]);
+                    }
+                    outElements.push_back(remap[vertex]);
+                }
+            }
+        }
+    };
+
+}
+
+void our::mesh_utils::simplify(const std::vector<our::Vertex>& vertices, const std::vector<GLuint>& elements,
+                               int targetTriangles, float maxError,
+                               std::vector<our::Vertex>& outVertices, std::vector<GLuint>& outElements) {
+    Simplifier simplifier(vertices, elements);
+    // The error of the quadrics is a squared distance, so we compare it with the square of the given distance.
+    simplifier.run(targetTriangles, (double)maxError * (double)maxError);
+    simplifier.output(outVertices, outElements);
+}
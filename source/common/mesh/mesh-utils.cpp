@@ -7,7 +7,7 @@
 
 #include <iostream>
 
-our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
+our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename, int lodLevels, float lodError, float lodRatio) {
 
     // The data that we will use to initialize our mesh
     std::vector<our::Vertex> vertices;
@@ -109,6 +109,30 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
     our::Mesh *newMesh = new our::Mesh(vertices, elements);
     newMesh->farLeft = farLeft; newMesh->farRight = farRight;
     newMesh->zNearest = zNearest; newMesh->zFurthest = zFurthest;
+
+    // Generate the coarser levels of detail (if requested). Every level is simplified from the previous one,
+    // and a level is only kept if it has noticeably less triangles than the previous one.
+    if (lodLevels > 1) {
+        int originalTriangles = (int)(elements.size() / 3);
+        std::string report = std::to_string(originalTriangles);
+        
+        std::vector<our::Vertex> lodVertices = vertices, simplifiedVertices;
+        std::vector<GLuint> lodElements = elements, simplifiedElements;
+        for (int level = 1; level < lodLevels; level++) {
+            int targetTriangles = (int)(originalTriangles * glm::pow(lodRatio, (float)level));
+            float maxError = lodError * level * newMesh->boundingSphereRadius;
+            simplify(lodVertices, lodElements, targetTriangles, maxError, simplifiedVertices, simplifiedElements);
+            
+            if (simplifiedElements.empty() || simplifiedElements.size() > lodElements.size() * 9 / 10) break;
+            
+            newMesh->lods.push_back(new our::Mesh(simplifiedVertices, simplifiedElements));
+            std::swap(lodVertices, simplifiedVertices);
+            std::swap(lodElements, simplifiedElements);
+            report += ", " + std::to_string(lodElements.size() / 3);
+        }
+        std::cout << "LODs of \"" << filename << "\" (triangles per level): " << report << std::endl;
+    }
+
     return newMesh;
 }
 
@@ -230,7 +254,7 @@ our::MultipleMeshes* our::mesh_utils::loadMultipleOBJ(const std::string& filenam
 
 // Create a sphere (the vertex order in the triangles are CCW from the outside)
 // Segments define the number of divisions on the both the latitude and the longitude
-our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments){
+our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments, bool objLayout){
     std::vector<our::Vertex> vertices;
     std::vector<GLuint> elements;
 
@@ -243,6 +267,8 @@ our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments){
             float u = (float)lng/segments.x;
             float yaw = u * glm::two_pi<float>();
             glm::vec3 normal = {cos * glm::cos(yaw), sin, cos * glm::sin(yaw)};
+            // The layout of "sphere.obj" is a mirror of this one, so its triangles are also flipped below.
+            if(objLayout) normal = {-cos * glm::cos(yaw), -cos * glm::sin(yaw), sin};
             glm::vec3 position = normal;
             glm::vec2 tex_coords = glm::vec2(u, v);
             our::Color color = our::Color(255, 255, 255, 255);
@@ -254,14 +280,27 @@ our::Mesh* our::mesh_utils::sphere(const glm::ivec2& segments){
         int start = lat*(segments.x+1);
         for(int lng = 1; lng <= segments.x; lng++){
             int prev_lng = lng-1;
-            elements.push_back(lng + start);
-            elements.push_back(lng + start - segments.x - 1);
-            elements.push_back(prev_lng + start - segments.x - 1);
-            elements.push_back(prev_lng + start - segments.x - 1);
-            elements.push_back(prev_lng + start);
-            elements.push_back(lng + start);
+            GLuint quad[6] = {
+                GLuint(lng + start), GLuint(lng + start - segments.x - 1), GLuint(prev_lng + start - segments.x - 1),
+                GLuint(prev_lng + start - segments.x - 1), GLuint(prev_lng + start), GLuint(lng + start)
+            };
+            if(objLayout){
+                std::swap(quad[1], quad[2]);
+                std::swap(quad[4], quad[5]);
+            }
+            elements.insert(elements.end(), quad, quad + 6);
         }
     }
 
     return new our::Mesh(vertices, elements);
-}
\ No newline at end of file
+}
+
+our::Mesh* our::mesh_utils::sphereLODs(const std::vector<glm::ivec2>& segments){
+    if(segments.empty()) return nullptr;
+    
+    our::Mesh* mesh = sphere(segments[0], true);
+    for(size_t level = 1; level < segments.size(); level++){
+        mesh->lods.push_back(sphere(segments[level], true));
+    }
+    return mesh;
+}
@@ -3,15 +3,35 @@
 #include "mesh.hpp"
 #include "multiple-meshes.hpp"
 #include <string>
+#include <vector>
 
 namespace our::mesh_utils {
     // Load an ".obj" file into the mesh (multiple objects are mereged into one mesh).
-    Mesh* loadOBJ(const std::string& filename);
+    // If "lodLevels" is more than 1, the mesh is simplified into "lodLevels - 1" coarser levels of detail
+    // which are stored in the mesh "lods". Level i targets "lodRatio" to the power i of the original triangles
+    // while keeping the error below "i * lodError" multiplied by the mesh bounding sphere radius.
+    Mesh* loadOBJ(const std::string& filename, int lodLevels = 1, float lodError = 0.0f, float lodRatio = 0.5f);
     
     // Load the objects ".obj" file into multiple meshes.
     our::MultipleMeshes* loadMultipleOBJ(const std::string& filename);
 
     // Create a sphere (the vertex order in the triangles are CCW from the outside)
     // Segments define the number of divisions on the both the latitude and the longitude
-    Mesh* sphere(const glm::ivec2& segments);
+    // If "objLayout" is true, the sphere is laid out like "assets/models/sphere.obj": the poles are on the Z axis
+    // (v goes from -Z to +Z) and u goes around it starting from -X towards -Y, so the textures made for it wrap the same way.
+    Mesh* sphere(const glm::ivec2& segments, bool objLayout = false);
+
+    // Create a chain of spheres (one per element of "segments") to be used as levels of detail.
+    // The first element should have the most segments. The returned mesh is the first level,
+    // and the rest are stored in its "lods" (and owned by it).
+    // They replace "assets/models/sphere.obj", so they use its layout (see "sphere").
+    Mesh* sphereLODs(const std::vector<glm::ivec2>& segments);
+
+    // Simplify the given triangles using the quadric error metric (implemented in "mesh-simplifier.cpp").
+    // Edges are collapsed until the number of triangles is at most "targetTriangles", or until the cheapest collapse
+    // would move the surface by more than (approximately) "maxError" (in the mesh local units).
+    // The result is written to "outVertices" and "outElements".
+    void simplify(const std::vector<Vertex>& vertices, const std::vector<GLuint>& elements,
+                  int targetTriangles, float maxError,
+                  std::vector<Vertex>& outVertices, std::vector<GLuint>& outElements);
 }
\ No newline at end of file
@@ -3,7 +3,12 @@
 #include <glad/gl.h>
 #include "GLFW/glfw3.h"
 #include "vertex.hpp"
+#include "mesh-arena.hpp"
+#include "../metrics.hpp"
 #include <iostream>
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 namespace our {
 
@@ -12,11 +17,23 @@ namespace our {
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
 
+    // The locations of the per-instance attributes used by instanced drawing.
+    // A mat4 attribute occupies 4 consecutive locations and a mat3 occupies 3.
+    #define ATTRIB_LOC_INSTANCE_MODEL  4
+    #define ATTRIB_LOC_INSTANCE_NORMAL 8
+
+    // The data stored in the instance buffer for every instance.
+    struct InstanceData {
+        glm::mat4 model;        // The local to world matrix of the instance
+        glm::mat3 normalMatrix; // The inverse transpose of the upper 3x3 part of the model matrix
+    };
+
     class Mesh {
-        // Here, we store the object names of the 3 main components of a mesh:
-        // A vertex array object, A vertex buffer and an element buffer
-        unsigned int VBO, EBO;
-        unsigned int VAO;
+        // Comment:
+        // The mesh doesn't own any OpenGL objects. Its vertices and elements are ranges inside the shared buffers
+        // of the mesh arena (see "mesh-arena.hpp"), and it is drawn using the arena's vertex array, with the first
+        // vertex of its range as the base vertex (so the elements are still relative to the mesh's own vertices).
+        ArenaRange vertexRange, elementRange;
         // We need to remember the number of elements that will be draw by glDrawElements 
         GLsizei elementCount;
     public:
@@ -28,10 +45,25 @@ namespace our {
 
         glm::vec3 zNearest, zFurthest;
 
+        // The bounding volumes of the mesh in its local (object) space.
+        // They are computed once from the vertices when the mesh is created, and are
+        // later transformed to the world space by the renderer to cull invisible objects.
+        glm::vec3 aabbMin = glm::vec3(0.0f), aabbMax = glm::vec3(0.0f);
+        glm::vec3 boundingSphereCenter = glm::vec3(0.0f);
+        float boundingSphereRadius = 0.0f;
+        // The distance from the bounding sphere center to the nearest triangle plane. For a convex mesh
+        // (e.g. a sphere), this is the radius of the largest sphere that fits inside it, which makes it
+        // safe to use for occlusion culling.
+        float innerRadius = 0.0f;
+
+        // The coarser levels of detail of this mesh, ordered from the most detailed to the least detailed.
+        // The mesh itself is level 0, so "lods[0]" is level 1 and so on. They are owned by this mesh
+        // and deleted with it. The renderer picks a level for every object based on its size on the screen.
+        std::vector<Mesh*> lods;
+
         void getAll() {
-            std::cout << VBO << std::endl;
-            std::cout << VAO << std::endl;
-            std::cout << EBO << std::endl;
+            std::cout << vertexRange.offset << " " << vertexRange.count << std::endl;
+            std::cout << elementRange.offset << " " << elementRange.count << std::endl;
 
             std::cout << elementCount << std::endl;
         }
@@ -39,72 +71,108 @@ namespace our {
         // The constructor takes two vectors:
         // - vertices which contain the vertex data.
         // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
-        // The mesh class does not keep a these data on the RAM. Instead, it should create
-        // a vertex buffer to store the vertex data on the VRAM,
-        // an element buffer to store the element data on the VRAM,
-        // a vertex array object to define how to read the vertex & element buffer during rendering 
+        // The mesh class does not keep a these data on the RAM. Instead, it uploads them to
+        // the shared vertex & element buffers of the mesh arena, and remembers their ranges.
         Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements)
         {
-            // DONE: (Req 2) Write this function
-            // remember to store the number of elements in "elementCount" since you will need it for drawing
-            // For the attribute locations, use the constants defined above: ATTRIB_LOC_POSITION, ATTRIB_LOC_COLOR, etc
-
-            // Creating Vertex Buffer
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);            
-
-            // Creating element buffer.
-            glGenBuffers(1, &EBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int), &elements[0], GL_STATIC_DRAW);
-
+            MeshArena::get().allocate(vertices, elements, vertexRange, elementRange);
             elementCount = elements.size();
-            
-            // Creating a vertex array.
-            glGenVertexArrays(1, &VAO);
 
-            glBindVertexArray(VAO);
-
-                glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            computeBoundingVolumes(vertices, elements);
+        }
 
-                glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
-                glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+        // This function computes the axis aligned bounding box of the given vertices, and a bounding sphere
+        // centered at the center of that box, with a radius equal to the distance to the furthest vertex.
+        // It also computes the inner radius from the planes of the triangles.
+        void computeBoundingVolumes(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements) {
+            if (vertices.empty()) return;
+
+            aabbMin = glm::vec3(std::numeric_limits<float>::max());
+            aabbMax = glm::vec3(std::numeric_limits<float>::lowest());
+            for (const auto& vertex : vertices) {
+                aabbMin = glm::min(aabbMin, vertex.position);
+                aabbMax = glm::max(aabbMax, vertex.position);
+            }
+
+            boundingSphereCenter = (aabbMin + aabbMax) * 0.5f;
+            float maxDistanceSquared = 0.0f;
+            for (const auto& vertex : vertices) {
+                glm::vec3 difference = vertex.position - boundingSphereCenter;
+                maxDistanceSquared = glm::max(maxDistanceSquared, glm::dot(difference, difference));
+            }
+            boundingSphereRadius = glm::sqrt(maxDistanceSquared);
+
+            innerRadius = boundingSphereRadius;
+            for (size_t index = 0; index + 2 < elements.size(); index += 3) {
+                glm::vec3 p0 = vertices[elements[index]].position;
+                glm::vec3 normal = glm::cross(vertices[elements[index + 1]].position - p0, vertices[elements[index + 2]].position - p0);
+                float length = glm::length(normal);
+                if (length <= 0.0f) continue;
+                innerRadius = glm::min(innerRadius, glm::abs(glm::dot(normal / length, p0 - boundingSphereCenter)));
+            }
+        }
 
-                glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
-                glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, color));
+        // Reads the vertex and element data of the mesh back from the VRAM (since the mesh doesn't keep them on the RAM).
+        // This is slow, so it should only be used while loading (e.g. to merge static meshes together).
+        void readData(std::vector<Vertex>& vertices, std::vector<unsigned int>& elements) const {
+            MeshArena::get().read(vertexRange, elementRange, vertices, elements);
+        }
 
-                glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
-                glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, tex_coord));
+        // Returns the number of levels of detail, including the mesh itself.
+        int getLODCount() const { return 1 + (int)lods.size(); }
 
-                glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
-                glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+        // Returns the mesh at the given level of detail (the level is clamped to the available levels).
+        Mesh* getLOD(int level) {
+            if (level <= 0 || lods.empty()) return this;
+            return lods[std::min(level, (int)lods.size()) - 1];
+        }
 
-                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        // Returns the number of elements (indices) drawn by this mesh. The triangle count is a third of it.
+        GLsizei getElementCount() const { return elementCount; }
 
-            glBindVertexArray(0);
+        // Returns the size (in bytes) of the vertices and elements of this mesh and its levels of detail in the arena.
+        size_t getMemorySize() const {
+            size_t size = vertexRange.count * sizeof(Vertex) + elementRange.count * sizeof(GLuint);
+            for (const Mesh* lod : lods) size += lod->getMemorySize();
+            return size;
         }
 
+        // The offset of the first element of this mesh in the arena's element buffer (in elements, not bytes).
+        GLuint getFirstIndex() const { return (GLuint)elementRange.offset; }
+        // The offset of the first vertex of this mesh in the arena's vertex buffer, which is added to every element.
+        GLint getBaseVertex() const { return (GLint)vertexRange.offset; }
+
         // this function should render the mesh
         void draw() 
         {
-            // DONE: (Req 2) Write this function            
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, (void *)0);
+            MeshArena::get().bind();
+            metrics::drawCalls.add();
+            glDrawElementsBaseVertex(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT,
+                                     (void *)(elementRange.offset * sizeof(GLuint)), getBaseVertex());
         }
 
-        // this function should delete the vertex & element buffers and the vertex array object
-        ~Mesh(){
+        // This function draws "instanceCount" instances of the mesh in a single draw call.
+        // The per-instance data (see InstanceData) is read from the given buffer, which should hold at least "instanceCount" elements.
+        // The instance attributes are only (re)specified in the arena's vertex array when the buffer changes.
+        void drawInstanced(unsigned int buffer, GLsizei instanceCount)
+        {
+            MeshArena& arena = MeshArena::get();
+            arena.bind();
+            arena.bindInstanceBuffer(buffer);
+            metrics::drawCalls.add();
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT,
+                                              (void *)(elementRange.offset * sizeof(GLuint)), instanceCount, getBaseVertex());
+        }
 
-            // DONE: (Req 2) Write this function
-            glDeleteVertexArrays(1, &VAO);
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
+        // this function should return the ranges of the mesh to the arena
+        ~Mesh(){
+            MeshArena::get().release(vertexRange, elementRange);
 
+            for (auto lod : lods) delete lod;
         }
 
         Mesh(Mesh const &) = delete;
         Mesh &operator=(Mesh const &) = delete;
     };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,167 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+namespace our {
+
+    namespace {
+        // A function-local static, so the registry exists before any metric is constructed (whatever the order of the globals).
+        std::vector<Metric*>& getRegistry() {
+            static std::vector<Metric*> registry;
+            return registry;
+        }
+
+        template<typename T>
+        void writeValue(std::fstream& file, T value) {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    Metric::Metric(const char* name, Kind kind) : name(name), kind(kind) {
+        getRegistry().push_back(this);
+    }
+
+    const std::vector<Metric*>& getAllMetrics() {
+        return getRegistry();
+    }
+
+    namespace metrics {
+        Metric frameTime("frame time (us)", Metric::Kind::GAUGE);
+        Metric drawCalls("draw calls", Metric::Kind::COUNTER);
+        Metric stateChanges("state changes", Metric::Kind::COUNTER);
+        Metric visibleLights("visible lights", Metric::Kind::GAUGE);
+        Metric entities("entities", Metric::Kind::GAUGE);
+        Metric collisions("collisions", Metric::Kind::COUNTER);
+        Metric bytesUploaded("bytes uploaded", Metric::Kind::COUNTER);
+        Metric allocations("allocations", Metric::Kind::GAUGE);
+        Metric allocatedBytes("allocated bytes", Metric::Kind::GAUGE);
+    }
+
+    bool MetricsRecorder::open(const nlohmann::json& config, const std::string& outputPath) {
+        close();
+        if (outputPath.empty() && !config.value("enabled", false)) return false;
+
+        path = outputPath.empty() ? config.value("output", "metrics/metrics.csv") : outputPath;
+        // If the format isn't given (or the path comes from the command line), it is deduced from the extension of the output.
+        std::string formatName = outputPath.empty() ? config.value("format", "") : "";
+        if (formatName.empty()) formatName = std::filesystem::path(path).extension() == ".csv" ? "csv" : "binary";
+        if (formatName == "csv") format = Format::CSV;
+        else if (formatName == "binary") format = Format::BINARY;
+        else {
+            std::cerr << "ERROR: UNKNOWN METRICS FORMAT: " << formatName << " (EXPECTED \"csv\" OR \"binary\")" << std::endl;
+            return false;
+        }
+        ringFrames = std::max<uint64_t>(1, config.value("ring-frames", (uint64_t)216000));
+
+        std::error_code error;
+        std::filesystem::path filePath(path);
+        if (filePath.has_parent_path()) std::filesystem::create_directories(filePath.parent_path(), error);
+        auto mode = std::ios::out | std::ios::trunc;
+        if (format == Format::BINARY) mode |= std::ios::in | std::ios::binary;
+        file.open(path, mode);
+        if (!file) {
+            std::cerr << "ERROR: COULDN'T CREATE THE METRICS FILE: " << path << std::endl;
+            return false;
+        }
+
+        metrics = getAllMetrics();
+        framesWritten = 0;
+        stopping = false;
+        pending.clear();
+        writing.clear();
+        writeHeader();
+
+        writer = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                // The writer wakes up when a batch is ready (or every second, so a slow game still writes its frames).
+                wake.wait_for(lock, std::chrono::seconds(1), [this]() {
+                    return stopping || pending.size() >= framesPerBatch * (metrics.size() + 1);
+                });
+                bool stop = stopping;
+                std::swap(pending, writing);
+                lock.unlock();
+                writeRows(writing);
+                writing.clear();
+                lock.lock();
+                if (stop && pending.empty()) break;
+            }
+        });
+        std::cout << "Recording the metrics to: " << path << std::endl;
+        return true;
+    }
+
+    void MetricsRecorder::writeHeader() {
+        if (format == Format::CSV) {
+            file << "frame";
+            for (Metric* metric : metrics) file << ',' << metric->getName();
+            file << '\n';
+            return;
+        }
+        file.write("SRMT", 4);
+        writeValue<uint32_t>(file, VERSION);
+        writeValue<uint32_t>(file, (uint32_t)metrics.size());
+        writeValue<uint64_t>(file, ringFrames);
+        framesWrittenOffset = file.tellp();
+        writeValue<uint64_t>(file, 0);
+        for (Metric* metric : metrics) {
+            std::string name = metric->getName();
+            writeValue<uint16_t>(file, (uint16_t)name.size());
+            file.write(name.data(), (std::streamsize)name.size());
+        }
+        dataOffset = file.tellp();
+    }
+
+    void MetricsRecorder::writeRows(const std::vector<int64_t>& rows) {
+        if (rows.empty()) return;
+        size_t rowSize = metrics.size() + 1;
+        if (format == Format::CSV) {
+            for (size_t row = 0; row < rows.size(); row += rowSize) {
+                file << rows[row];
+                for (size_t index = 1; index < rowSize; index++) file << ',' << rows[row + index];
+                file << '\n';
+            }
+            file.flush();
+            return;
+        }
+        std::streamoff recordSize = (std::streamoff)(rowSize * sizeof(int64_t));
+        for (size_t row = 0; row < rows.size(); row += rowSize) {
+            uint64_t frame = (uint64_t)rows[row];
+            file.seekp(dataOffset + (std::streamoff)(frame % ringFrames) * recordSize);
+            file.write(reinterpret_cast<const char*>(&rows[row]), recordSize);
+            framesWritten++;
+        }
+        // The count in the header is updated after the frames, so a reader never sees a count that includes unwritten frames.
+        file.seekp(framesWrittenOffset);
+        writeValue<uint64_t>(file, framesWritten);
+        file.flush();
+    }
+
+    void MetricsRecorder::endFrame(uint64_t frame) {
+        if (!isRecording()) return;
+        bool notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back((int64_t)frame);
+            for (Metric* metric : metrics) pending.push_back(metric->sample());
+            notify = pending.size() >= framesPerBatch * (metrics.size() + 1);
+        }
+        if (notify) wake.notify_one();
+    }
+
+    void MetricsRecorder::close() {
+        if (!isRecording()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        writer.join();
+        file.close();
+        std::cout << "Metrics saved to: " << path << std::endl;
+    }
+
+}
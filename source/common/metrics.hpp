@@ -0,0 +1,114 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    // A named value that is sampled once per frame by the metrics recorder (see "MetricsRecorder").
+    // A counter adds up the amounts added during a frame and starts again from 0 when it is sampled (e.g. the draw calls),
+    // while a gauge keeps the last value it was set to (e.g. the number of entities).
+    // The value is a relaxed atomic, so it can be updated from any thread without a lock (the order of the updates doesn't matter,
+    // only their sum), and updating it costs about as much as a normal addition when there is no contention.
+    class Metric {
+    public:
+        enum class Kind { COUNTER, GAUGE };
+
+    private:
+        const char* name;
+        Kind kind;
+        std::atomic<int64_t> value{0};
+
+    public:
+        // Creates the metric and adds it to the registry (see "getAllMetrics"). The name must be a string literal.
+        // The metrics should be globals, so they are all registered before the recorder starts.
+        Metric(const char* name, Kind kind);
+
+        void add(int64_t amount = 1) { value.fetch_add(amount, std::memory_order_relaxed); }
+        void set(int64_t value) { this->value.store(value, std::memory_order_relaxed); }
+
+        // Returns the value of the frame that just ended (a counter starts again from 0).
+        int64_t sample() { return kind == Kind::COUNTER ? value.exchange(0, std::memory_order_relaxed) : value.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] const char* getName() const { return name; }
+        [[nodiscard]] Kind getKind() const { return kind; }
+
+        Metric(const Metric&) = delete;
+        Metric& operator=(const Metric&) = delete;
+    };
+
+    // Returns all the registered metrics in the order they were created.
+    const std::vector<Metric*>& getAllMetrics();
+
+    // The metrics of the engine.
+    namespace metrics {
+        extern Metric frameTime;      // The duration of the frame in microseconds (gauge)
+        extern Metric drawCalls;      // All the draw calls (meshes, batches, impostors, postprocessing passes and text glyphs) (counter)
+        extern Metric stateChanges;   // The shader program binds and uniform updates (counter)
+        extern Metric visibleLights;  // The lights used by the lit materials (gauge)
+        extern Metric entities;       // The entities of the rendered world (gauge)
+        extern Metric collisions;     // The collected collectables and the collisions with planets and aircrafts (counter)
+        extern Metric bytesUploaded;  // The bytes uploaded to buffers (instance data, draw data, impostors, text and meshes) (counter)
+        extern Metric allocations;    // The heap allocations made by all the threads during the frame (gauge, see "allocation-tracker.hpp")
+        extern Metric allocatedBytes; // The bytes requested by these allocations (gauge)
+    }
+
+    // Appends the values of all the metrics to a file every frame, so long runs can be graphed.
+    // Comment:
+    // The main thread samples the metrics at the end of every frame into a queue, and a background thread writes the queue
+    // to the file in batches (so the frames never wait for the disk). The file is either:
+    // - CSV: a header with the names of the metrics, then one line per frame ("frame,<metric>,<metric>,...").
+    // - Binary: a ring of the last "ring-frames" frames, so a run of any length uses a bounded amount of disk. It starts with
+    //   a header: "SRMT" (4 bytes), the version (uint32), the number of metrics (uint32), the number of frames in the ring (uint64),
+    //   the number of frames written so far (uint64, updated after every batch), then the name of every metric (a uint16 length
+    //   followed by the characters). Then come the frames: the frame number (uint64) followed by the value of every metric (int64).
+    //   Frame i is in slot (i % ring-frames), so once the ring is full, the oldest frame is in the slot after the newest one.
+    class MetricsRecorder {
+        static const uint32_t VERSION = 1;
+
+        enum class Format { CSV, BINARY };
+        Format format = Format::CSV;
+        std::string path;
+        std::fstream file;
+        uint64_t ringFrames = 0;
+        std::streamoff framesWrittenOffset = 0, dataOffset = 0;
+
+        std::vector<Metric*> metrics;
+        size_t framesPerBatch = 60;
+
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::vector<int64_t> pending, writing; // The rows of the frames (the frame number followed by the values)
+        uint64_t framesWritten = 0;             // Only used by the writer thread
+
+        void writeHeader();
+        void writeRows(const std::vector<int64_t>& rows);
+
+    public:
+        // Reads the configuration and starts recording if it is enabled:
+        // { "enabled": true, "output": "metrics/metrics.csv", "format": "csv" or "binary", "ring-frames": 216000 (binary only) }
+        // If the output path is not empty, it replaces the path in the configuration (and enables the recorder), and the format
+        // is deduced from its extension (CSV for ".csv", binary otherwise).
+        // Returns false if the file couldn't be created.
+        bool open(const nlohmann::json& config, const std::string& outputPath = "");
+        [[nodiscard]] bool isRecording() const { return writer.joinable(); }
+
+        // Samples all the metrics as the values of the given frame.
+        void endFrame(uint64_t frame);
+
+        // Writes the remaining frames and closes the file.
+        void close();
+        ~MetricsRecorder() { close(); }
+    };
+
+}
@@ -1,21 +1,45 @@
 #pragma once
 
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <stdexcept>
 #include <random>
+#include <chrono>
 
 namespace our {
 
+    // Formats a string into "output", reusing its memory (e.g. for a text that is updated every frame).
+    // Comment:
+    // The string is formatted into a buffer on the stack first, so nothing is allocated unless the result is longer than
+    // the buffer or than the memory "output" already has. Only the longer results are formatted a second time, directly into "output".
+    template<typename ... Args>
+    void string_format( std::string& output, const char* format, Args ... args )
+    {
+        char buffer[256];
+        int size = std::snprintf( buffer, sizeof(buffer), format, args ... );
+        if( size < 0 ){ throw std::runtime_error( "Error during formatting." ); }
+        if( static_cast<size_t>( size ) < sizeof(buffer) ){
+            output.assign( buffer, static_cast<size_t>( size ) );
+            return;
+        }
+        output.resize( static_cast<size_t>( size ) );
+        std::snprintf( output.data(), output.size() + 1, format, args ... ); // The string always has room for the '\0'
+    }
+
     // A convenient wrapper for formatting strings.
     template<typename ... Args>
-    std::string string_format( const std::string& format, Args ... args )
+    std::string string_format( const char* format, Args ... args )
     {
-        int size_s = std::snprintf( nullptr, 0, format.c_str(), args ... ) + 1; // Extra space for '\0'
-        if( size_s <= 0 ){ throw std::runtime_error( "Error during formatting." ); }
-        auto size = static_cast<size_t>( size_s );
-        std::unique_ptr<char[]> buf( new char[ size ] );
-        std::snprintf( buf.get(), size, format.c_str(), args ... );
-        return std::string( buf.get(), buf.get() + size - 1 ); // We don't want the '\0' inside
+        std::string output;
+        string_format( output, format, args ... );
+        return output;
+    }
+
+    // Returns the time (in seconds) since the first call. It is used instead of "glfwGetTime", which only works
+    // after GLFW is initialized (it isn't in headless mode, see "headless-context.hpp").
+    inline double getTime() {
+        static const auto start = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 }
\ No newline at end of file
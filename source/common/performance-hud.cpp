@@ -0,0 +1,120 @@
+#include "performance-hud.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace our {
+
+    void PerformanceHUD::setCount(const char* name, long long value) {
+        for (auto& count : counts) {
+            if (count.first == name || std::strcmp(count.first, name) == 0) {
+                count.second = value;
+                return;
+            }
+        }
+        counts.emplace_back(name, value);
+    }
+
+    void PerformanceHUD::updateZoneRows() {
+        Profiler::readThreadZones(zones);
+        zoneRows.clear();
+
+        // The zones are sorted by their start (an enclosing zone before the zones nested in it), then the depth of every zone
+        // is the number of zones that are still open when it starts.
+        std::sort(zones.begin(), zones.end(), [](const ProfiledZone& first, const ProfiledZone& second) {
+            if (first.start != second.start) return first.start < second.start;
+            return first.milliseconds > second.milliseconds;
+        });
+        openZoneEnds.clear();
+        for (const ProfiledZone& zone : zones) {
+            while (!openZoneEnds.empty() && openZoneEnds.back() <= zone.start) openZoneEnds.pop_back();
+            int depth = (int)openZoneEnds.size();
+            openZoneEnds.push_back(zone.start + zone.milliseconds);
+
+            auto row = std::find_if(zoneRows.begin(), zoneRows.end(), [&zone, depth](const ZoneRow& row) {
+                return row.depth == depth && (row.name == zone.name || std::strcmp(row.name, zone.name) == 0);
+            });
+            if (row != zoneRows.end()) {
+                row->milliseconds += zone.milliseconds;
+                row->allocations += zone.allocations.allocations;
+            } else {
+                zoneRows.push_back({zone.name, depth, zone.milliseconds, zone.allocations.allocations});
+            }
+        }
+    }
+
+    void PerformanceHUD::draw() {
+        if (!visible) return;
+        updateZoneRows();
+        if (++framesSinceAssetMemory >= ASSET_MEMORY_INTERVAL) {
+            assetMemory = getAssetMemoryUsage();
+            framesSinceAssetMemory = 0;
+        }
+
+        ImGui::SetNextWindowSize(ImVec2(440, 0), ImGuiCond_FirstUseEver);
+        if (!ImGui::Begin("Performance", &visible)) {
+            ImGui::End();
+            return;
+        }
+
+        // The frame times (the frames that weren't measured yet are zeros, so they are left out of the mean).
+        float last = frameTimes[(nextFrame + FRAME_HISTORY - 1) % FRAME_HISTORY];
+        float maximum = 0.0f, sum = 0.0f;
+        int measured = 0;
+        for (float frameTime : frameTimes) {
+            if (frameTime <= 0.0f) continue;
+            maximum = std::max(maximum, frameTime);
+            sum += frameTime;
+            measured++;
+        }
+        ImGui::Text("Frame: %.2f ms (%.0f FPS)", last, last > 0.0f ? 1000.0f / last : 0.0f);
+        ImGui::Text("Last %d frames: mean %.2f ms, max %.2f ms", measured, measured ? sum / measured : 0.0f, maximum);
+        ImGui::PlotLines("##frame-times", frameTimes.data(), (int)FRAME_HISTORY, (int)nextFrame, nullptr, 0.0f,
+                         std::max(maximum, 33.4f), ImVec2(-1.0f, 80.0f));
+        if (AllocationTracker::isEnabled()) {
+            ImGui::Text("Allocations: %llu (%.1f KB)", (unsigned long long)frameAllocations.allocations, frameAllocations.bytes / 1024.0);
+        }
+
+        const float valueColumn = 240.0f, allocationsColumn = 320.0f;
+        if (ImGui::CollapsingHeader("CPU (main thread)", ImGuiTreeNodeFlags_DefaultOpen)) {
+#if defined(ENABLE_PROFILER)
+            for (const ZoneRow& row : zoneRows) {
+                ImGui::Text("%*s%s", row.depth * 2, "", row.name);
+                ImGui::SameLine(valueColumn);
+                ImGui::Text("%8.3f ms", row.milliseconds);
+                if (row.allocations == 0) continue;
+                ImGui::SameLine(allocationsColumn);
+                ImGui::Text("%llu allocs", (unsigned long long)row.allocations);
+            }
+#else
+            ImGui::TextUnformatted("The profiler zones are not compiled (ENABLE_PROFILER is off).");
+#endif
+        }
+        if (!gpuTimes.empty() && ImGui::CollapsingHeader("GPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (auto& [name, milliseconds] : gpuTimes) {
+                ImGui::TextUnformatted(name);
+                ImGui::SameLine(valueColumn);
+                ImGui::Text("%8.3f ms", milliseconds);
+            }
+        }
+        if (!counts.empty() && ImGui::CollapsingHeader("Counts", ImGuiTreeNodeFlags_DefaultOpen)) {
+            for (auto& [name, value] : counts) {
+                ImGui::TextUnformatted(name);
+                ImGui::SameLine(valueColumn);
+                ImGui::Text("%8lld", value);
+            }
+        }
+        if (ImGui::CollapsingHeader("Assets")) {
+            for (const AssetMemory& memory : assetMemory) {
+                ImGui::Text("%s: %zu", memory.type, memory.count);
+                if (memory.bytes == 0) continue;
+                ImGui::SameLine(valueColumn);
+                ImGui::Text("%8.2f MB", memory.bytes / (1024.0 * 1024.0));
+            }
+        }
+        ImGui::End();
+    }
+
+}
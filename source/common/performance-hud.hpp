@@ -0,0 +1,79 @@
+#pragma once
+
+#include "asset-loader.hpp"
+#include "profiler.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace our {
+
+    // An ImGui window that shows where the frames go: a graph of the recent frame times, the CPU time of the profiler zones
+    // of the main thread (see "profiler.hpp"), the GPU time of the passes, the counts reported by the current state
+    // (entities, draw calls, triangles, lights, culled commands, etc.), the heap allocations of the frame and of every zone
+    // (see "allocation-tracker.hpp") and the memory of the loaded assets by type.
+    // Comment:
+    // The CPU times are read from the profiler every frame, so the profiler is enabled while the HUD is visible.
+    // The zones are shown as a tree (by their nesting), and the zones with the same name at the same depth (e.g. the texts)
+    // are added together. The GPU times and the counts are reported by the state after it draws (see "setGPUTimes" and "setCount"),
+    // so they are a frame old when the HUD is drawn, like the CPU times.
+    class PerformanceHUD {
+        static const size_t FRAME_HISTORY = 240;
+        // How often (in frames) the memory of the assets is measured (it queries OpenGL for the size of every texture).
+        static const int ASSET_MEMORY_INTERVAL = 60;
+
+        struct ZoneRow {
+            const char* name;
+            int depth;
+            double milliseconds;
+            uint64_t allocations;
+        };
+
+        bool visible = false;
+
+        std::vector<float> frameTimes = std::vector<float>(FRAME_HISTORY, 0.0f);
+        size_t nextFrame = 0;
+        AllocationCounts frameAllocations;
+
+        std::vector<ProfiledZone> zones;
+        std::vector<ZoneRow> zoneRows;
+        std::vector<double> openZoneEnds; // The end times of the zones enclosing the current one (while building the tree)
+
+        std::vector<std::pair<const char*, float>> gpuTimes;
+        std::vector<std::pair<const char*, long long>> counts;
+
+        std::vector<AssetMemory> assetMemory;
+        int framesSinceAssetMemory = ASSET_MEMORY_INTERVAL;
+
+        // Reads the zones recorded since the last frame and turns them into rows.
+        void updateZoneRows();
+
+    public:
+        void setVisible(bool visible) { this->visible = visible; }
+        [[nodiscard]] bool isVisible() const { return visible; }
+
+        // Adds the duration (in seconds) of the last frame to the graph.
+        void addFrameTime(double frameTime) {
+            frameTimes[nextFrame] = (float)(frameTime * 1000.0);
+            nextFrame = (nextFrame + 1) % FRAME_HISTORY;
+        }
+
+        // Sets the heap allocations made by all the threads during the last frame.
+        void addFrameAllocations(const AllocationCounts& allocations) { frameAllocations = allocations; }
+
+        // Replaces the GPU times shown by the HUD (the names must stay valid, e.g. the names returned by "GPUTimers::getTimes").
+        void setGPUTimes(const std::vector<std::pair<const char*, float>>& times) { gpuTimes.assign(times.begin(), times.end()); }
+        // Sets the value of a count shown by the HUD (the name must be a string literal). The counts are shown in the order they were first set.
+        void setCount(const char* name, long long value);
+        // Removes the GPU times and the counts (e.g. when the state changes, since the new state may not report them).
+        void clearStateData() {
+            gpuTimes.clear();
+            counts.clear();
+        }
+
+        // Draws the HUD window (if visible). It must be called between ImGui::NewFrame and ImGui::Render.
+        void draw();
+    };
+
+}
@@ -0,0 +1,184 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace our {
+
+    namespace {
+        // A zone (from "start" to "end") and the allocations made during it, or the value of a counter at "start".
+        struct Zone {
+            const char* name;
+            uint64_t start, end;
+            double value;
+            bool counter;
+            AllocationCounts allocations;
+        };
+
+        // The ring buffer of one thread. Only its thread writes the zones, and "count" (the number of zones ever recorded)
+        // is published after the zone is written, so the trace writer can read the buffer without a lock.
+        struct ThreadZones {
+            std::string name;
+            uint32_t id = 0;
+            std::unique_ptr<Zone[]> zones;
+            std::atomic<uint64_t> count{0};
+        };
+
+        // The buffers are never removed (even when their threads end), so the zones of finished threads still appear in the trace.
+        std::mutex registryMutex;
+        std::vector<std::unique_ptr<ThreadZones>> registry;
+        thread_local ThreadZones* threadZones = nullptr;
+        thread_local std::string threadName;
+        // The number of zones of the calling thread already returned by "readThreadZones".
+        thread_local uint64_t readZones = 0;
+
+        // The names returned by "intern" (the nodes of an unordered set never move, so their strings stay where they are).
+        std::mutex namesMutex;
+        std::unordered_set<std::string> names;
+
+        // The ticks and the steady clock time at which the profiler was first enabled (the trace starts there).
+        bool calibrated = false;
+        uint64_t baseTicks = 0;
+        std::chrono::steady_clock::time_point baseTime;
+
+        ThreadZones* registerThread() {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            auto zones = std::make_unique<ThreadZones>();
+            zones->id = (uint32_t)registry.size();
+            zones->name = threadName.empty() ? "thread " + std::to_string(zones->id) : threadName;
+            zones->zones = std::make_unique<Zone[]>(Profiler::ZONES_PER_THREAD);
+            threadZones = zones.get();
+            registry.push_back(std::move(zones));
+            return threadZones;
+        }
+
+        // Returns the number of ticks per microsecond, measured over the whole time since the profiler was enabled.
+        // It must be called while holding the registry lock.
+        double measureTicksPerMicrosecond() {
+            if (!calibrated) return 1.0;
+            uint64_t ticks = Profiler::now();
+            double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - baseTime).count();
+            return microseconds > 0.0 && ticks > baseTicks ? (double)(ticks - baseTicks) / microseconds : 1.0;
+        }
+    }
+
+    void Profiler::setEnabled(bool enabled) {
+        if (enabled) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            if (!calibrated) {
+                baseTicks = now();
+                baseTime = std::chrono::steady_clock::now();
+                calibrated = true;
+            }
+        }
+        Profiler::enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void Profiler::setThreadName(const std::string& name) {
+        threadName = name;
+        if (threadZones) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            threadZones->name = name;
+        }
+    }
+
+    void Profiler::record(const char* name, uint64_t start, uint64_t end, const AllocationCounts& allocations) {
+        ThreadZones* zones = threadZones ? threadZones : registerThread();
+        uint64_t index = zones->count.load(std::memory_order_relaxed);
+        zones->zones[index & (ZONES_PER_THREAD - 1)] = {name, start, end, 0.0, false, allocations};
+        zones->count.store(index + 1, std::memory_order_release);
+    }
+
+    void Profiler::recordCounter(const char* name, double value) {
+        ThreadZones* zones = threadZones ? threadZones : registerThread();
+        uint64_t index = zones->count.load(std::memory_order_relaxed);
+        zones->zones[index & (ZONES_PER_THREAD - 1)] = {name, now(), 0, value, true, {}};
+        zones->count.store(index + 1, std::memory_order_release);
+    }
+
+    const char* Profiler::intern(const std::string& name) {
+        std::lock_guard<std::mutex> lock(namesMutex);
+        return names.insert(name).first->c_str();
+    }
+
+    void Profiler::readThreadZones(std::vector<ProfiledZone>& result) {
+        result.clear();
+        ThreadZones* zones = threadZones;
+        if (!zones) return;
+        double ticksPerMillisecond;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            ticksPerMillisecond = measureTicksPerMicrosecond() * 1000.0;
+        }
+
+        uint64_t count = zones->count.load(std::memory_order_relaxed);
+        for (uint64_t index = std::max(readZones, count > ZONES_PER_THREAD ? count - ZONES_PER_THREAD : 0); index < count; index++) {
+            const Zone& zone = zones->zones[index & (ZONES_PER_THREAD - 1)];
+            if (zone.counter) continue;
+            result.push_back({zone.name, (double)(int64_t)(zone.start - baseTicks) / ticksPerMillisecond,
+                              (double)(int64_t)(zone.end - zone.start) / ticksPerMillisecond, zone.allocations});
+        }
+        readZones = count;
+    }
+
+    bool Profiler::writeChromeTrace(const std::string& path) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        double ticksPerMicrosecond = measureTicksPerMicrosecond();
+
+        std::error_code error;
+        std::filesystem::path filePath(path);
+        if (filePath.has_parent_path()) std::filesystem::create_directories(filePath.parent_path(), error);
+        std::ofstream file(filePath);
+        if (!file) {
+            std::cerr << "ERROR: COULDN'T WRITE THE PROFILER TRACE TO: " << path << std::endl;
+            return false;
+        }
+
+        // Every zone is written as a "complete" event (ph = X) with its start and duration in microseconds,
+        // every counter value as a "counter" event (ph = C), and every thread gets a metadata event (ph = M) with its name.
+        // The zones that allocated get their allocations as arguments (shown when the zone is selected).
+        size_t zoneCount = 0;
+        char line[256];
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (auto& zones : registry) {
+            std::snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                          first ? "" : ",", zones->id, zones->name.c_str());
+            file << line;
+            first = false;
+
+            uint64_t count = zones->count.load(std::memory_order_acquire);
+            for (uint64_t index = count > ZONES_PER_THREAD ? count - ZONES_PER_THREAD : 0; index < count; index++) {
+                const Zone& zone = zones->zones[index & (ZONES_PER_THREAD - 1)];
+                double start = (double)(int64_t)(zone.start - baseTicks) / ticksPerMicrosecond;
+                if (zone.counter) {
+                    std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.4f}}",
+                                  zone.name, zones->id, start, zone.value);
+                } else if (zone.allocations.allocations > 0) {
+                    double duration = (double)(int64_t)(zone.end - zone.start) / ticksPerMicrosecond;
+                    std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                                  "\"args\":{\"allocations\":%llu,\"allocated bytes\":%llu}}",
+                                  zone.name, zones->id, start, duration,
+                                  (unsigned long long)zone.allocations.allocations, (unsigned long long)zone.allocations.bytes);
+                } else {
+                    double duration = (double)(int64_t)(zone.end - zone.start) / ticksPerMicrosecond;
+                    std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                                  zone.name, zones->id, start, duration);
+                }
+                file << line;
+            }
+            zoneCount += (size_t)std::min<uint64_t>(count, ZONES_PER_THREAD);
+        }
+        file << "\n]}" << std::endl;
+        std::cout << "Profiler trace (" << zoneCount << " zones) saved to: " << path << std::endl;
+        return true;
+    }
+
+}
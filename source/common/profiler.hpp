@@ -0,0 +1,116 @@
+#pragma once
+
+#include "allocation-tracker.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define OUR_PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define OUR_PROFILER_RDTSC
+#endif
+
+namespace our {
+
+    // A zone read back from the profiler (see "Profiler::readThreadZones"). The start is relative to the time the profiler was first enabled.
+    // The allocations are the heap allocations made by the thread during the zone (including its nested zones, see "allocation-tracker.hpp").
+    struct ProfiledZone {
+        const char* name;
+        double start, milliseconds;
+        AllocationCounts allocations;
+    };
+
+    // Comment:
+    // The profiler measures named zones (scopes) of the code on every thread and writes them as a Chrome trace
+    // (open it in chrome://tracing or https://ui.perfetto.dev). A zone is measured by putting OUR_PROFILE_ZONE("name") at the start of a scope.
+    // Every thread writes its zones into its own ring buffer, which only keeps its last ZONES_PER_THREAD zones, so recording
+    // a zone doesn't need any lock (only the first zone of a thread takes a lock to register its buffer).
+    // The zones are timed with the time stamp counter of the CPU (rdtsc) where it is available, and with the steady clock otherwise.
+    // The ticks are converted to microseconds when the trace is written, by comparing them to the steady clock.
+    // Every zone also records the heap allocations made by its thread while it was open (see "allocation-tracker.hpp").
+    // If the profiler is disabled, a zone costs one relaxed atomic load and a branch. If the project is built without
+    // ENABLE_PROFILER (see the CMake option), the zones are removed entirely.
+    class Profiler {
+        inline static std::atomic<bool> enabled{false};
+
+    public:
+        static constexpr size_t ZONES_PER_THREAD = 1 << 15; // Must be a power of 2
+
+        // Starts (or stops) recording the zones.
+        static void setEnabled(bool enabled);
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+        // Names the calling thread in the trace (the threads are named "thread N" by default).
+        static void setThreadName(const std::string& name);
+
+        // Returns the current time in ticks (see the comment above).
+        static uint64_t now() {
+#if defined(OUR_PROFILER_RDTSC)
+            return __rdtsc();
+#else
+            return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        // Adds a zone to the ring buffer of the calling thread. The name must stay valid until the trace is written (e.g. a string literal).
+        // The allocations are the ones made by the thread between the start and the end of the zone.
+        static void record(const char* name, uint64_t start, uint64_t end, const AllocationCounts& allocations = {});
+        // Adds the current value of a counter (e.g. the GPU time of a pass) to the ring buffer of the calling thread.
+        // The trace shows every counter as a graph next to the zones. The name must stay valid like the names of the zones.
+        static void recordCounter(const char* name, double value);
+
+        // Returns a copy of the given name that stays valid until the program exits (for names that aren't string literals).
+        // It takes a lock, so the result should be kept instead of calling it every frame.
+        static const char* intern(const std::string& name);
+
+        // Replaces the content of "zones" with the zones recorded by the calling thread since the last call (as far as its ring buffer goes),
+        // in the order they ended (so a zone comes after the zones nested in it). It is used to show the zones live (see "performance-hud.hpp").
+        static void readThreadZones(std::vector<ProfiledZone>& zones);
+
+        // Writes the zones kept by all the threads to a Chrome trace (JSON) file. Returns false if the file couldn't be written.
+        // It should be called while the other threads are idle (e.g. between frames), since their buffers are read without a lock.
+        static bool writeChromeTrace(const std::string& path);
+    };
+
+    // Measures the time between its construction and its destruction as a zone of the profiler (see "OUR_PROFILE_ZONE").
+    class ProfileZone {
+        const char* name = nullptr;
+        uint64_t start = 0;
+        AllocationCounts startAllocations;
+
+    public:
+        explicit ProfileZone(const char* name) {
+            if (Profiler::isEnabled()) {
+                this->name = name;
+                startAllocations = AllocationTracker::getThreadCounts();
+                start = Profiler::now();
+            }
+        }
+        ~ProfileZone() {
+            if (name) {
+                uint64_t end = Profiler::now();
+                Profiler::record(name, start, end, AllocationTracker::getThreadCounts() - startAllocations);
+            }
+        }
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+    };
+
+}
+
+#define OUR_PROFILE_CONCATENATE_(first, second) first##second
+#define OUR_PROFILE_CONCATENATE(first, second) OUR_PROFILE_CONCATENATE_(first, second)
+
+// Measures the rest of the current scope as a zone with the given name (which must be a string literal).
+#if defined(ENABLE_PROFILER)
+#define OUR_PROFILE_ZONE(name) our::ProfileZone OUR_PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#else
+#define OUR_PROFILE_ZONE(name)
+#endif
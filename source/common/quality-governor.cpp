@@ -0,0 +1,71 @@
+#include "quality-governor.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace our {
+
+    void QualityGovernor::initialize(const nlohmann::json& config) {
+        enabled = config.value("enabled", false);
+        targetMilliseconds = config.value("target-frame-time", 16.7f);
+        hysteresis = config.value("hysteresis", 0.15f);
+        window = (size_t)std::max(config.value("window", 120), 10);
+        float minRenderScale = std::clamp(config.value("min-render-scale", 0.5f), 0.25f, 1.0f);
+
+        // Comment:
+        // Every level is the previous one with a single knob changed. The render scale is lowered in small steps since
+        // it is the cheapest to notice at high resolutions, and the postprocess effects are dropped before the lights,
+        // since they are only applied for short durations (e.g. the speedup).
+        QualitySettings settings;
+        levels.assign(1, settings);
+        auto addLevel = [&]() { levels.push_back(settings); };
+        settings.renderScale = std::max(0.85f, minRenderScale); addLevel();
+        settings.lodBias = 1; addLevel();
+        settings.postprocess = false; addLevel();
+        settings.renderScale = std::max(0.7f, minRenderScale); addLevel();
+        settings.maxLights = 8; addLevel();
+        settings.lodBias = 2; addLevel();
+        settings.renderScale = minRenderScale; addLevel();
+        settings.maxLights = 2; addLevel();
+
+        level = 0;
+        frameTimes.assign(window, 0.0f);
+        sortedFrameTimes.resize(window);
+        nextFrame = filled = 0;
+        p95 = 0.0f;
+    }
+
+    void QualityGovernor::update(double frameTime) {
+        if (!enabled) return;
+
+        frameTimes[nextFrame] = (float)(frameTime * 1000.0);
+        nextFrame = (nextFrame + 1) % window;
+        if (filled < window) filled++;
+        if (filled < window) return;
+
+        sortedFrameTimes = frameTimes;
+        size_t index = (window * 95) / 100;
+        std::nth_element(sortedFrameTimes.begin(), sortedFrameTimes.begin() + index, sortedFrameTimes.end());
+        p95 = sortedFrameTimes[index];
+
+        int previousLevel = level;
+        if (p95 > targetMilliseconds * (1.0f + hysteresis) && level + 1 < (int)levels.size()) level++;
+        else if (p95 < targetMilliseconds * (1.0f - hysteresis) && level > 0) level--;
+        if (level != previousLevel) filled = 0;
+    }
+
+    void QualityGovernor::drawOverlay() const {
+        const QualitySettings& settings = getSettings();
+        ImGui::Begin("Quality");
+        ImGui::Text("Frame time p95: %.2f ms (target %.2f ms)", p95, targetMilliseconds);
+        ImGui::Text("Level: %d / %d", level, (int)levels.size() - 1);
+        ImGui::Text("Render scale: %.2f", settings.renderScale);
+        ImGui::Text("LOD bias: %d", settings.lodBias);
+        if (settings.maxLights < 0) ImGui::Text("Max lights: all");
+        else ImGui::Text("Max lights: %d", settings.maxLights);
+        ImGui::Text("Postprocess: %s", settings.postprocess ? "on" : "off");
+        ImGui::End();
+    }
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace our {
+
+    // The quality knobs that the renderer reads every frame.
+    struct QualitySettings {
+        float renderScale = 1.0f; // The resolution of the scene relative to the window (it is upscaled by the postprocess pass)
+        int lodBias = 0;          // The number of levels of detail added to the level picked for every object
+        int maxLights = -1;       // The maximum number of lights used by the lit materials (-1 means all of them)
+        bool postprocess = true;  // Whether the postprocess effects are applied
+    };
+
+    // Adjusts the quality settings to keep the frame time under a target.
+    // Comment:
+    // The governor keeps the work times (see "update") of the last few frames (the "window"), and looks at their 95th percentile, which
+    // reacts to frequent hitches but not to a single one. If it is above the target by more than the hysteresis, the quality
+    // is lowered by one level, and if it is below the target by more than the hysteresis, it is raised by one level.
+    // After every change, the window is emptied (the old frames don't reflect the new settings), so the next change can only
+    // happen after it fills again. The levels are ordered from the best looking to the cheapest; every level
+    // changes one knob, starting with the ones that are the least visible.
+    class QualityGovernor {
+        bool enabled = false;
+        float targetMilliseconds = 16.7f;
+        float hysteresis = 0.15f;
+        size_t window = 120;
+
+        std::vector<QualitySettings> levels;
+        int level = 0;
+
+        std::vector<float> frameTimes, sortedFrameTimes;
+        size_t nextFrame = 0, filled = 0;
+        float p95 = 0.0f;
+
+    public:
+        // Reads the configuration:
+        // { "enabled": false, "target-frame-time": 16.7 (ms), "hysteresis": 0.15, "window": 120 (frames), "min-render-scale": 0.5 }
+        void initialize(const nlohmann::json& config);
+
+        // Records the work time of the last frame (in seconds) and updates the quality level if needed. It must not include
+        // the wait for the swap, otherwise a vsynced frame never gets below the refresh period and the quality never recovers.
+        void update(double frameTime);
+
+        // Draws the current quality level and knobs in an ImGui window.
+        void drawOverlay() const;
+
+        const QualitySettings& getSettings() const { return levels[level]; }
+        bool isEnabled() const { return enabled; }
+        int getLevel() const { return level; }
+        float getP95() const { return p95; }
+    };
+
+}
@@ -19,9 +19,14 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
         return false;
     }
     std::string sourceString = std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
-    const char* sourceCStr = sourceString.c_str();
     file.close();
 
+    return attachSource(sourceString, type, filename);
+}
+
+bool our::ShaderProgram::attachSource(const std::string &sourceString, GLenum type, const std::string &name) const {
+    const char* sourceCStr = sourceString.c_str();
+
     // DONE: Complete this function
     // Note: The function "checkForShaderCompilationErrors" checks if there is
     // an error in the given shader. You should use it to check if there is a
@@ -34,7 +39,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
     
     if (std::string error = checkForShaderCompilationErrors(shader); !error.empty()) {
         
-        std::cerr << "Error in compiling shader, at path: " << filename << std::endl;
+        std::cerr << "Error in compiling shader, at path: " << name << std::endl;
         
         std::cerr << error << std::endl;
         return false;
@@ -57,6 +62,7 @@ bool our::ShaderProgram::link() const {
     // program. The returned string will be empty if there is no errors.
 
     glLinkProgram(program);
+    uniformLocations.clear();
     if ( std::string error = checkForLinkingErrors(program); !error.empty()) {
         std::cerr << error << std::endl;
         return false;
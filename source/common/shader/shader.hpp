@@ -1,12 +1,16 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+#include <map>
 #include <string>
+#include <string_view>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "../metrics.hpp"
+
 namespace our {
 
     class ShaderProgram {
@@ -15,7 +19,25 @@ namespace our {
         //Shader Program Handle (OpenGL object name)
         GLuint program;
 
+        // Comment:
+        // The uniform locations are looked up by name only once and cached here, since "glGetUniformLocation"
+        // is a string search inside the driver, and the renderer sets the same uniforms for every draw call.
+        // The cache is cleared whenever the program is (re)linked, since linking may move the uniforms.
+        // It is an ordered map with a transparent comparator, so it can be searched with a string view (e.g. a string literal)
+        // without building a std::string (which would allocate for the longer names) on every call.
+        mutable std::map<std::string, GLint, std::less<>> uniformLocations;
+
     public:
+        // An optional variant of this program that reads the model (and normal) matrices from per-instance
+        // vertex attributes instead of uniforms. It is used by the renderer to draw many objects sharing
+        // the same mesh and material using a single instanced draw call.
+        // If it is not null, it is owned by this program and deleted with it.
+        ShaderProgram* instancedVariant = nullptr;
+        // An optional variant of this program that reads the model (and normal) matrices of every draw from a texture
+        // buffer, indexed by the draw ID. It is used by the renderer to submit many objects sharing the same material
+        // (but not necessarily the same mesh) using a single multi-draw call. It is owned by this program too.
+        ShaderProgram* multiDrawVariant = nullptr;
+
         ShaderProgram(){ 
             // DONE: (Req 1) Create A shader program
             program = glCreateProgram();
@@ -23,53 +45,79 @@ namespace our {
         ~ShaderProgram(){
             //DONE: (Req 1) Delete a shader program
             glDeleteProgram(program);
+            delete instancedVariant;
+            delete multiDrawVariant;
         }
 
         bool attach(const std::string &filename, GLenum type) const;
 
+        // Compiles the given GLSL code and attaches it to the program (used for generated shaders).
+        // "name" is only used to identify the shader in the error messages.
+        bool attachSource(const std::string &source, GLenum type, const std::string &name) const;
+
         bool link() const;
 
         void use() { 
+            metrics::stateChanges.add();
             glUseProgram(program);
         }
 
-        GLuint getUniformLocation(const std::string &name) {
+        GLuint getUniformLocation(std::string_view name) {
             // DONE: (Req 1) Return the location of the uniform with the given name.
-            return glGetUniformLocation(program, name.c_str());
+            auto it = uniformLocations.find(name);
+            if (it == uniformLocations.end()) {
+                std::string key(name);
+                GLint location = glGetUniformLocation(program, key.c_str());
+                it = uniformLocations.emplace(std::move(key), location).first;
+            }
+            return it->second;
         }
 
-        void set(const std::string &uniform, GLfloat value) {
+        void set(std::string_view uniform, GLfloat value) {
             // DONE: (Req 1) Send the given float value to the given uniform
+            metrics::stateChanges.add();
             glUniform1f(getUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, GLuint value) {
+        void set(std::string_view uniform, GLuint value) {
             // DONE: (Req 1) Send the given unsigned integer value to the given uniform
+            metrics::stateChanges.add();
             glUniform1ui(getUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, GLint value) {
+        void set(std::string_view uniform, GLint value) {
             // DONE: (Req 1) Send the given integer value to the given uniform
+            metrics::stateChanges.add();
             glUniform1i(getUniformLocation(uniform), value);
         }
 
-        void set(const std::string &uniform, glm::vec2 value) {
+        void set(std::string_view uniform, glm::vec2 value) {
             // DONE: (Req 1) Send the given 2D vector value to the given uniform
+            metrics::stateChanges.add();
             glUniform2fv(getUniformLocation(uniform), 1, &value[0]);
         }
 
-        void set(const std::string &uniform, glm::vec3 value) {
+        void set(std::string_view uniform, glm::vec3 value) {
             // DONE: (Req 1) Send the given 3D vector value to the given uniform
+            metrics::stateChanges.add();
             glUniform3fv(getUniformLocation(uniform), 1, &value[0]);
         }
 
-        void set(const std::string &uniform, glm::vec4 value) {
+        void set(std::string_view uniform, glm::vec4 value) {
             // DONE: (Req 1) Send the given 4D vector value to the given uniform
+            metrics::stateChanges.add();
             glUniform4fv(getUniformLocation(uniform), 1, &value[0]);
         }
 
-        void set(const std::string &uniform, glm::mat4 matrix) {
+        void set(std::string_view uniform, glm::mat3 matrix) {
+            // Send the given matrix 3x3 value to the given uniform
+            metrics::stateChanges.add();
+            glUniformMatrix3fv(getUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(matrix));
+        }
+
+        void set(std::string_view uniform, glm::mat4 matrix) {
             // DONE: (Req 1) Send the given matrix 4x4 value to the given uniform
+            metrics::stateChanges.add();
             glUniformMatrix4fv(getUniformLocation(uniform), 1, GL_FALSE, glm::value_ptr(matrix));
         }
 
@@ -3,9 +3,11 @@
 #include "../components/camera.hpp"
 #include "../ecs/world.hpp"
 #include "ecs/entity.hpp"
+#include "../profiler.hpp"
+#include "../metrics.hpp"
 
 #include <glm/glm.hpp>
-#include <unordered_set>
+#include <vector>
 
 #include <irrKlang.h>
 #include <conio.h>
@@ -14,6 +16,11 @@
 
 namespace our {
 class CollisionDetectionSystem {
+    // The collectables collected in the current update. They are kept between the updates (and cleared after every one),
+    // so they reuse their memory instead of allocating it every frame. Every entity is visited once, so they hold no duplicates.
+    std::vector<Entity*> collected;
+    std::vector<Entity*> toCollectIfSpeed;
+
 public:
     
     // This should be called every frame to check if any collisions happened.
@@ -27,16 +34,18 @@ public:
     // a collectable and a planet will never be rendered closely in the world. This is now guaranteed because
     // we render the coins on the track, and the planets everywhere else.
     int update(World *world, glm::vec3 updatedPosition, irrklang::ISoundEngine* engine, bool *forbiddenCollision, our::SpeedCollectableInfo *speed) {
+        OUR_PROFILE_ZONE("collision");
 
         if (!world)
             return 0;
 
-        std::unordered_set<Entity*> collected;
-        std::unordered_set<Entity*> toCollectIfSpeed;
-
         // Initialize it to be false.
         *forbiddenCollision = false;
 
+        // The collected lists can hold all the entities, so collecting the coins doesn't allocate.
+        collected.reserve(world->getEntities().size());
+        toCollectIfSpeed.reserve(world->getEntities().size());
+
         // Iterate over all the entities in the world.
         for (auto it = world->getEntities().begin(); it != world->getEntities().end(); it++) {
             
@@ -48,7 +57,7 @@ public:
                 // If the distance is less than a manually fine-tuned threshold, then remove the coin
                 // from the world, and play a sound.
                 if (distance < 3.5) {                    
-                    collected.insert(*it);
+                    collected.push_back(*it);
                     engine->play2D("assets/sounds/coin.wav");
                     continue;
                 }
@@ -61,7 +70,7 @@ public:
                     (speed->zAtTimeOfCollection != 100.0) && 
                     ((*it)->localTransform.position.z < speed->zAtTimeOfCollection) &&
                     abs((*it)->localTransform.position.z - updatedPosition.z) <= 1
-                ) toCollectIfSpeed.insert(*it);
+                ) toCollectIfSpeed.push_back(*it);
             
             
             }             
@@ -71,7 +80,7 @@ public:
                 float distance = glm::distance((*it)->localTransform.position, updatedPosition);
                 if (distance < 3.0) {
                     speed->inEffect = true;
-                    collected.insert(*it);
+                    collected.push_back(*it);
                 } else {
                     speed->inEffect = false;
                 }
@@ -108,8 +117,12 @@ public:
             }
         }
 
+        // The hits with a planet or an aircraft, then the collectables (see below) are counted as collisions (see "metrics.hpp").
+        if (*forbiddenCollision) metrics::collisions.add();
+
         // If speed mode is in effect, collect all the coins in approximity to you.
         if (speed->timeSince != 0.0) {
+            metrics::collisions.add((int64_t)toCollectIfSpeed.size());
             for (auto it = toCollectIfSpeed.begin(); it != toCollectIfSpeed.end(); it++) {
                 world->markForRemoval(*it);
                 world->setOfSpaceArtifacts.erase(*it);
@@ -121,6 +134,7 @@ public:
 
         // Removing the deleted artifacts from the set of space artifacts.
         // This should be separate to the above loop so that everything is not fucked up.
+        metrics::collisions.add((int64_t)collected.size());
         for (auto it = collected.begin(); it != collected.end(); it++) {
             world->markForRemoval(*it);
             world->setOfSpaceArtifacts.erase(*it);
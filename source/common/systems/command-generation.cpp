@@ -0,0 +1,99 @@
+#include "command-generation.hpp"
+#include "frustum-culling.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../components/multiple-meshes-renderer.hpp"
+#include "../profiler.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    // The number of chunks given to every thread, and the minimum number of entities in a chunk.
+    static const size_t CHUNKS_PER_THREAD = 4;
+    static const size_t MIN_ENTITIES_PER_CHUNK = 256;
+
+    CameraComponent* CommandGenerator::generate(World* world, Entity* excluded, ThreadPool* pool,
+                                                std::vector<RenderCommand>& opaqueCommands, std::vector<RenderCommand>& transparentCommands) {
+        entities.assign(world->getEntities().begin(), world->getEntities().end());
+
+        size_t threads = pool ? pool->size() : 1;
+        size_t chunkCount = std::max<size_t>(1, std::min(threads * CHUNKS_PER_THREAD, entities.size() / MIN_ENTITIES_PER_CHUNK));
+        size_t chunkSize = (entities.size() + chunkCount - 1) / std::max<size_t>(chunkCount, 1);
+        if (chunks.size() < chunkCount) chunks.resize(chunkCount);
+
+        auto job = [&](size_t index) {
+            OUR_PROFILE_ZONE("command chunk");
+            ChunkBuffers& buffers = chunks[index];
+            buffers.opaqueCommands.clear();
+            buffers.transparentCommands.clear();
+            buffers.camera = nullptr;
+            size_t first = std::min(index * chunkSize, entities.size()), last = std::min(first + chunkSize, entities.size());
+            generateChunk(entities.data() + first, entities.data() + last, excluded, buffers);
+        };
+        if (pool) pool->run(chunkCount, job);
+        else for (size_t index = 0; index < chunkCount; index++) job(index);
+
+        // Merge the buffers in the chunk order (reserving first so every list grows at most once).
+        size_t opaqueCount = opaqueCommands.size(), transparentCount = transparentCommands.size();
+        for (size_t index = 0; index < chunkCount; index++) {
+            opaqueCount += chunks[index].opaqueCommands.size();
+            transparentCount += chunks[index].transparentCommands.size();
+        }
+        opaqueCommands.reserve(opaqueCount);
+        transparentCommands.reserve(transparentCount);
+
+        CameraComponent* camera = nullptr;
+        for (size_t index = 0; index < chunkCount; index++) {
+            ChunkBuffers& buffers = chunks[index];
+            opaqueCommands.insert(opaqueCommands.end(), buffers.opaqueCommands.begin(), buffers.opaqueCommands.end());
+            transparentCommands.insert(transparentCommands.end(), buffers.transparentCommands.begin(), buffers.transparentCommands.end());
+            if (!camera) camera = buffers.camera;
+        }
+        return camera;
+    }
+
+    void CommandGenerator::generateChunk(Entity* const* first, Entity* const* last, Entity* excluded, ChunkBuffers& buffers) {
+        for (Entity* const* it = first; it != last; it++) {
+            Entity* entity = *it;
+
+            // If we hadn't found a camera yet, we look for a camera in this entity
+            if (!buffers.camera) buffers.camera = entity->getComponent<CameraComponent>();
+
+            // The excluded entity (the aircraft) gets a command of its own in the renderer.
+            if (entity == excluded) continue;
+
+            // If this entity has a mesh renderer component, we construct a command from it
+            if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer) {
+                RenderCommand command;
+                command.localToWorld = entity->getLocalToWorldMatrix();
+                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+                command.mesh = meshRenderer->mesh;
+                command.material = meshRenderer->material;
+                command.lodLevel = &meshRenderer->lodLevel;
+                command.boundingSphere = transformBoundingSphere(command.localToWorld, command.mesh->boundingSphereCenter, command.mesh->boundingSphereRadius);
+
+                // if it is transparent, we add it to the transparent commands list. Otherwise, to the opaque command list.
+                if (command.material->transparent) buffers.transparentCommands.push_back(command);
+                else buffers.opaqueCommands.push_back(command);
+
+            } else if (auto multipleMeshRender = entity->getComponent<MultipleMeshesRendererComponent>(); multipleMeshRender) {
+                glm::mat4 localToWorld = entity->getLocalToWorldMatrix();
+                auto material = multipleMeshRender->materials->begin();
+                for (auto mesh = multipleMeshRender->meshes->listOfMeshes->begin(); mesh != multipleMeshRender->meshes->listOfMeshes->end(); mesh++) {
+                    RenderCommand command;
+                    command.localToWorld = localToWorld;
+                    command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+                    command.mesh = (*mesh);
+                    command.material = (*material);
+                    command.boundingSphere = transformBoundingSphere(command.localToWorld, command.mesh->boundingSphereCenter, command.mesh->boundingSphereRadius);
+
+                    if (command.material->transparent) buffers.transparentCommands.push_back(command);
+                    else buffers.opaqueCommands.push_back(command);
+
+                    material++;
+                }
+            }
+        }
+    }
+
+}
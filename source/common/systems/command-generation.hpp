@@ -0,0 +1,38 @@
+#pragma once
+
+#include "render-proxies.hpp"
+#include "../thread-pool.hpp"
+#include "../components/camera.hpp"
+
+#include <vector>
+
+namespace our {
+
+    // Builds the render commands of all the entities of a world, splitting the entities across a thread pool.
+    // Comment:
+    // The entities are divided into contiguous chunks (a few per thread so the threads stay busy when some chunks are
+    // heavier than others). Every chunk fills its own opaque and transparent buffers, so the threads never share
+    // anything they write to. The buffers are then appended in the chunk order, which gives the exact same lists
+    // as a single threaded loop over the entities. Nothing here touches OpenGL, so it can run on any thread.
+    class CommandGenerator {
+        struct ChunkBuffers {
+            std::vector<RenderCommand> opaqueCommands, transparentCommands;
+            CameraComponent* camera = nullptr;
+        };
+
+        // A snapshot of the world's entities (the set can't be split by index), and the buffers of every chunk.
+        std::vector<Entity*> entities;
+        std::vector<ChunkBuffers> chunks;
+
+        // Builds the commands of the entities in [first, last) into the given buffers.
+        static void generateChunk(Entity* const* first, Entity* const* last, Entity* excluded, ChunkBuffers& buffers);
+
+    public:
+        // Appends the commands of all the entities of the world (except "excluded") to the opaque and transparent lists,
+        // and returns the first camera found among the entities (or null if there is none).
+        // If the pool is null, everything runs on the calling thread.
+        CameraComponent* generate(World* world, Entity* excluded, ThreadPool* pool,
+                                  std::vector<RenderCommand>& opaqueCommands, std::vector<RenderCommand>& transparentCommands);
+    };
+
+}
@@ -0,0 +1,79 @@
+#include "depth-sort.hpp"
+
+#include <cstring>
+
+namespace our {
+
+    // The insertion sort gives up once it moved more than this many elements per object.
+    static const size_t INSERTION_SORT_MOVES_PER_OBJECT = 2;
+
+    const std::vector<uint32_t>& DepthSorter::sortBackToFront(const std::vector<float>& squaredDistances) {
+        size_t count = squaredDistances.size();
+
+        // Comment:
+        // Non negative floats have the same order as their bits read as unsigned integers. Since we want the farthest
+        // object first, the bits are inverted, which turns the sort into an ascending one on the keys.
+        keys.resize(count);
+        for (size_t index = 0; index < count; index++) {
+            float distance = squaredDistances[index] > 0.0f ? squaredDistances[index] : 0.0f;
+            uint32_t bits;
+            std::memcpy(&bits, &distance, sizeof(bits));
+            keys[index] = ~bits;
+        }
+
+        fastPathUsed = count == previousCount && insertionSort();
+        if (!fastPathUsed) radixSort();
+        previousCount = count;
+        return order;
+    }
+
+    bool DepthSorter::insertionSort() {
+        // The order is compared by key then by index, which is the order produced by the stable radix sort.
+        auto before = [this](uint32_t first, uint32_t second) {
+            return keys[first] < keys[second] || (keys[first] == keys[second] && first < second);
+        };
+
+        size_t budget = INSERTION_SORT_MOVES_PER_OBJECT * order.size();
+        for (size_t index = 1; index < order.size(); index++) {
+            uint32_t current = order[index];
+            size_t position = index;
+            while (position > 0 && before(current, order[position - 1])) {
+                order[position] = order[position - 1];
+                position--;
+                if (budget-- == 0) return false;
+            }
+            order[position] = current;
+        }
+        return true;
+    }
+
+    void DepthSorter::radixSort() {
+        size_t count = keys.size();
+        order.resize(count);
+        scratch.resize(count);
+        for (size_t index = 0; index < count; index++) order[index] = (uint32_t)index;
+
+        // Comment:
+        // The keys are sorted one byte at a time starting from the least significant one. Every pass is a stable
+        // counting sort, so the order of the previous passes (and of the input for equal keys) is preserved.
+        // The passes in which all the keys share the same byte don't change anything and are skipped.
+        for (int shift = 0; shift < 32; shift += 8) {
+            size_t histogram[256] = {};
+            for (size_t index = 0; index < count; index++) histogram[(keys[index] >> shift) & 0xFF]++;
+            if (count == 0 || histogram[(keys[0] >> shift) & 0xFF] == count) continue;
+
+            size_t offset = 0;
+            for (size_t& bucket : histogram) {
+                size_t size = bucket;
+                bucket = offset;
+                offset += size;
+            }
+            for (size_t index = 0; index < count; index++) {
+                uint32_t object = order[index];
+                scratch[histogram[(keys[object] >> shift) & 0xFF]++] = object;
+            }
+            order.swap(scratch);
+        }
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // Orders the transparent objects from back to front using their squared distance to the camera.
+    // Comment:
+    // Every object gets one integer key per frame (the bits of its squared distance, which preserve the order of
+    // positive floats), and the keys are sorted with a stable LSD radix sort. Equal keys keep their input order,
+    // so the result is deterministic.
+    // While flying, the order barely changes from a frame to the next, so the sorter first tries an insertion sort
+    // starting from the previous frame's order, and only falls back to the radix sort if that takes too many moves.
+    // Both paths give the exact same order, since ties are broken by the input index in both.
+    class DepthSorter {
+        std::vector<uint32_t> keys;
+        std::vector<uint32_t> order, scratch;
+        // The number of objects sorted in the last frame (the previous order is only reused if it didn't change).
+        size_t previousCount = 0;
+        bool fastPathUsed = false;
+
+        bool insertionSort();
+        void radixSort();
+
+    public:
+        // Returns the indices of the objects ordered from the farthest to the nearest.
+        // "squaredDistances" holds the squared distance from the camera to every object.
+        const std::vector<uint32_t>& sortBackToFront(const std::vector<float>& squaredDistances);
+
+        // Makes room for sorting the given number of objects, so sorting up to that many doesn't allocate.
+        void reserve(size_t count) {
+            keys.reserve(count);
+            order.reserve(count);
+            scratch.reserve(count);
+        }
+
+        // Returns true if the last sort reused the previous frame's order.
+        bool usedFastPath() const { return fastPathUsed; }
+    };
+
+}
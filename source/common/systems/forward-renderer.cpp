@@ -12,16 +12,79 @@
 #include "shader/shader.hpp"
 #include <glm/ext/matrix_transform.hpp>
 #include "../our-util.hpp"
+#include "../deserialize-utils.hpp"
+#include "../profiler.hpp"
+#include "../metrics.hpp"
 #include "texture/texture-gif.hpp"
 #include "texture/texture2d.hpp"
 #include "../states/extra-definitions.hpp"
 
 namespace our {
 
+    // The number of frames that draw every command when the renderer starts (see "render").
+    static const int PREWARM_FRAMES = 3;
+
     void ForwardRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json& config){
         // First, we store the window size for later use
         this->windowSize = windowSize;
 
+        // Frustum culling is enabled unless the configuration explicitly disables it.
+        this->frustumCullingEnabled = config.value("frustum-culling", true);
+
+        // The shaders are prewarmed unless the configuration explicitly disables it.
+        this->prewarmFramesLeft = config.value("prewarm", true) ? PREWARM_FRAMES : 0;
+
+        // Instancing is also enabled by default. The instance buffer is filled before every instanced draw call.
+        this->instancingEnabled = config.value("instancing", true);
+        glGenBuffers(1, &instanceBuffer);
+
+        // Multi-draw batching is enabled by default too. The draw data buffer is read through a buffer texture.
+        this->multiDrawEnabled = config.value("multi-draw", true);
+        this->drawIDSupported = GLAD_GL_ARB_shader_draw_parameters;
+        glGenBuffers(1, &drawDataBuffer);
+        glGenTextures(1, &drawDataTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, drawDataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, drawDataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, drawDataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // The levels of detail are selected using the thresholds in the configuration (if any).
+        // Without thresholds, every object is drawn using the most detailed level.
+        if (config.contains("lod")) {
+            const nlohmann::json& lod = config["lod"];
+            lodPixelRadii = lod.value("pixel-radii", std::vector<float>());
+            lodHysteresis = lod.value("hysteresis", 0.15f);
+        }
+
+        // In the retained mode, the render commands persist between frames (see RenderProxies).
+        retainedEnabled = config.value("retained", false);
+
+        // Comment:
+        // The worker threads are shared by the CPU-side stages of the renderer (the command generation and the occlusion culling).
+        // "threads" is the number of worker threads; the main thread always works too, so 0 means single threaded.
+        int threads = config.value("threads", (int)std::min(3u, std::max(1u, std::thread::hardware_concurrency()) - 1));
+        workerPool = std::make_unique<ThreadPool>((size_t)std::max(threads, 0));
+
+        // Comment:
+        // The occlusion culling is configured by its resolution, the number of occluders, and the meshes that can be occluders.
+        if (config.contains("occlusion")) {
+            const nlohmann::json& occlusion = config["occlusion"];
+            occlusionCullingEnabled = occlusion.value("enabled", true);
+            if (occlusionCullingEnabled) {
+                occlusionBuffer.initialize(occlusion.value("resolution", glm::ivec2(256, 128)), workerPool.get());
+                maxOccluders = occlusion.value("max-occluders", 16);
+                for (auto& name : occlusion.value("occluder-meshes", std::vector<std::string>{"sphere"})) {
+                    if (Mesh* mesh = AssetLoader<Mesh>::get(name); mesh) occluderMeshes.insert(mesh);
+                }
+            }
+        }
+
+        // The impostors are baked here, so the assets must be loaded before initializing the renderer.
+        if (config.contains("impostors")) {
+            impostors.initialize(config["impostors"]);
+        }
+
         // Then we check if there is a sky texture in the configuration
         if(config.contains("sky")){
             // First, we create a sphere which will be used to draw the sky
@@ -76,73 +139,13 @@ namespace our {
         }
 
         // Then we check if there is a postprocessing shader in the configuration
-        
-        // Comment:
-        // Here, we generate the frame buffer, and we bind it to the GL_FRAMEBUFFER so that anything
-        // that gets rendered, gets rendered to it, not the default framebuffer.
-        // We create the two textures associated with it: for the color buffer and the depth buffer.
-        // We create the attachments of the color buffer texture and the depth buffer texture using: glFramebufferTexture2D call.
-        // We check the status of completion of the framebuffer, and just print an indicative statement.
-        // Then we unbind the framebuffer, and generate the vertex array of the postprocess material, to be later used 
-        // when rendering the postprocess material/mesh.
-        if(config.contains("postprocess")){
-            
-            if (auto& effects = config["postprocess"]; effects.is_object() && !effects.empty()) {
-                
-                //DONE: (Req 11) Create a framebuffer
-                glGenFramebuffers(1, &(this->postprocessFrameBuffer));
-                glBindFramebuffer(GL_FRAMEBUFFER, this->postprocessFrameBuffer); 
-
-                //DONE: (Req 11) Create a color and a depth texture and attach them to the framebuffer
-                // Hints: The color format can be (Red, Green, Blue and Alpha components with 8 bits for each channel).
-                // The depth format can be (Depth component with 24 bits).
-                this->colorTarget = texture_utils::empty(GL_RGBA8, this->windowSize);
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->colorTarget->getOpenGLName(), 0);
-
-                this->depthTarget = texture_utils::empty(GL_DEPTH_COMPONENT24, this->windowSize);
-                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depthTarget->getOpenGLName(), 0);
-
-                if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-                    std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-
-                //DONE: (Req 11) Unbind the framebuffer just to be safe
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-                // Create a vertex array to use for drawing the texture
-                glGenVertexArrays(1, &postProcessVertexArray);
-
-                // Create a sampler to use for sampling the scene texture in the post processing shader
-                Sampler* postprocessSampler = new Sampler();
-                postprocessSampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                postprocessSampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                postprocessSampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                postprocessSampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-                for(auto& [name, desc] : effects.items()){                  
-                    // Create the post processing shader
-                    ShaderProgram* shader = new ShaderProgram();
-                    shader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
-                    shader->attach(desc, GL_FRAGMENT_SHADER);
-                    shader->link();
-
-                    // Create a post processing material
-                    TexturedMaterial* material = new TexturedMaterial();
-                    material->shader = shader;
-                    material->texture = colorTarget;
-                    material->sampler = postprocessSampler;
-                    // The default options are fine but we don't need to interact with the depth buffer
-                    // so it is more performant to disable the depth mask
-                    material->pipelineState.depthMask = false;
-
-                    postprocessShaders[name] = shader;
-                    postprocessMaterials[name] = material;
-
-                    if (name == "default") postprocessInEffect = name;
-                }
-
-                if (postprocessInEffect == "-1") std::cerr << "WARNING:: NO DEFAULT POSTPROCESS EFFECT IS SUPPLIED." << std::endl;
-
-            }
+        // (see "postprocessor.hpp" for how the effects are described and applied).
+        // The postprocessor is initialized even without effects, since it also upsamples the scene when the render scale is below 1.
+        nlohmann::json effects = config.value("postprocess", nlohmann::json::object());
+        postprocessor.initialize(this->windowSize, effects.is_object() ? effects : nlohmann::json::object());
+        if(effects.is_object() && !effects.empty()){
+            if (effects.contains("default")) postprocessInEffect = "default";
+            if (postprocessInEffect == "-1") std::cerr << "WARNING:: NO DEFAULT POSTPROCESS EFFECT IS SUPPLIED." << std::endl;
         }
 
         // Initialize the material associated with the red plane that appears
@@ -174,68 +177,70 @@ namespace our {
             delete skyMaterial;
         }
         // Delete all objects related to post processing
-        for (auto it = postprocessShaders.begin(); it != postprocessShaders.end(); it++) delete it->second;
-        for (auto it = postprocessMaterials.begin(); it != postprocessMaterials.end(); it++) delete it->second;
+        postprocessor.destroy();
+        gpuTimers.destroy();
 
-        postprocessShaders.clear();
-        postprocessMaterials.clear();
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+        glDeleteTextures(1, &drawDataTexture);
+        glDeleteBuffers(1, &drawDataBuffer);
+        drawDataTexture = drawDataBuffer = 0;
+
+        impostors.destroy();
+        renderProxies.clear();
+        workerPool.reset();
+        occluderMeshes.clear();
 
     }
 
-    void ForwardRenderer::render(World* world, bool forbiddenAccess, our::GameConfig gameConfig){
+    void ForwardRenderer::render(World* world, bool forbiddenAccess, const our::GameConfig& gameConfig){
+        OUR_PROFILE_ZONE("render");
+        gpuTimers.newFrame();
+
         // First of all, we search for a camera and for all the mesh renderers
         CameraComponent* camera = nullptr;
         
         opaqueCommands.clear();
         transparentCommands.clear();
-        for(auto entity : world->getEntities()){
-
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if(!camera) camera = entity->getComponent<CameraComponent>();
-
-            // If this is the aircraft entity, leave it for later.
-            // We will construct a command for it specially after this for loop.
-            if (entity == world->airCraftEntity)
-                continue;
-
-            // If this entity has a mesh renderer component
-            if(auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer){
-                
-                // We construct a command from it 
-                RenderCommand command;
-                command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
-                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-                command.mesh = meshRenderer->mesh;
-                command.material = meshRenderer->material;
-
-
-                // if it is transparent, we add it to the transparent commands list
-                if(command.material->transparent){
-                    transparentCommands.push_back(command);
-                } else {
-                // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
-                }
-            } else if (auto multipleMeshRender = entity->getComponent<MultipleMeshesRendererComponent>(); multipleMeshRender) {
-                
-                auto material = multipleMeshRender->materials->begin();
-                for (auto mesh = multipleMeshRender->meshes->listOfMeshes->begin(); mesh != multipleMeshRender->meshes->listOfMeshes->end(); mesh++) {
-                    RenderCommand command;
-                    
-                    command.localToWorld = multipleMeshRender->getOwner()->getLocalToWorldMatrix();
-                    command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-                    command.mesh = (*mesh);
-                    command.material = (*material); 
-
-                    if (command.material->transparent) {
-                        transparentCommands.push_back(command);
-                    } else {
-                        opaqueCommands.push_back(command);
-                    }
-
-                    material++;
-                }
+        metrics::entities.set((int64_t)world->getEntities().size());
 
+        // Comment:
+        // In the retained mode, the commands are kept in the render proxies between frames, and only the ones
+        // that changed are updated. The camera is the one kept by the world, and the commands are collected
+        // from the proxies after the camera is known (see below), so only the visible ones are copied.
+        {
+            OUR_PROFILE_ZONE("command build");
+            if (retainedEnabled) {
+                renderProxies.synchronize(world, world->airCraftEntity);
+                camera = world->camera;
+
+                // The lists and the scratch buffers of the frame can take all the proxies (and the aircraft), so a frame that
+                // shows more of them than the previous frames doesn't allocate. They only grow on the frames that add proxies.
+                size_t maxCommands = renderProxies.size() + 1;
+                opaqueCommands.reserve(maxCommands);
+                transparentCommands.reserve(maxCommands);
+                cullingSpheres.reserve(maxCommands);
+                cullingResults.reserve(maxCommands);
+                occluderCandidates.reserve(maxCommands);
+                impostors.reserve(maxCommands);
+                transparentDistances.reserve(maxCommands);
+                sortedCommands.reserve(maxCommands);
+                transparentSorter.reserve(maxCommands);
+                instanceData.reserve(maxCommands);
+                drawData.reserve(maxCommands);
+                drawCounts.reserve(maxCommands);
+                drawOffsets.reserve(maxCommands);
+                drawBaseVertices.reserve(maxCommands);
+            } else {
+                // The records are only used by the render proxies, so we drop them to keep them from growing.
+                world->addedRenderables.clear();
+                world->removedRenderables.clear();
+                world->changedTransforms.clear();
+
+                // Comment:
+                // Otherwise, the commands are rebuilt from all the entities. The entities are split across the worker threads,
+                // and the aircraft is left for later, since we construct a command for it specially after this.
+                camera = commandGenerator.generate(world, world->airCraftEntity, workerPool.get(), opaqueCommands, transparentCommands);
             }
         }
 
@@ -271,18 +276,108 @@ namespace our {
 
         // Comment: cameraPosition is used later when setting the uniform camera_position for lit materials.
         glm::vec3 cameraPosition = glm::vec3(camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0,0,0, 1));
-        
-        std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand& first, const RenderCommand& second){
-            //DONE: (Req 9) Finish this function
-            // HINT: the following return should return true if "first" should be drawn before "second".
-            return length(cameraForward - first.center) >= length(cameraForward - second.center);
-        });
 
         //DONE: (Req 9) Get the camera ViewProjection matrix and store it in VP
         glm::mat4 VP = camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
 
+        // Comment:
+        // The first frames prewarm the shaders: they draw every command, without culling or impostors. The first one draws
+        // each command on its own, the second one only instances the groups sharing a mesh, and the third one also submits
+        // the multi-draw batches. So every shader and state that a later frame can use reaches the driver (which may only
+        // compile them on their first draw, e.g. llvmpipe) before the flight, instead of stalling (and allocating) the first
+        // time an object comes into view.
+        bool prewarming = prewarmFramesLeft > 0;
+
+        // Comment:
+        // Before sorting and drawing anything, we drop the commands that cannot be seen by the camera.
+        // The frustum planes are extracted from VP, and every command's world-space bounding sphere is tested against them.
+        // The aircraft command is not culled since it is always in front of the camera.
+        // In the retained mode, the proxies are culled while their commands are collected.
+        stats = RenderStats();
+        if (retainedEnabled) {
+            OUR_PROFILE_ZONE("frustum culling");
+            stats.updatedProxies = (int)renderProxies.getUpdatedCount();
+            Frustum frustum = Frustum::fromViewProjection(VP);
+            stats.culledCommands += (int)renderProxies.collect(frustumCullingEnabled && !prewarming ? &frustum : nullptr, opaqueCommands, transparentCommands);
+        } else if (frustumCullingEnabled && !prewarming) {
+            OUR_PROFILE_ZONE("frustum culling");
+            Frustum frustum = Frustum::fromViewProjection(VP);
+            cullCommands(opaqueCommands, frustum);
+            cullCommands(transparentCommands, frustum);
+        }
+        // Comment:
+        // The commands that survived the frustum culling are then tested against the occlusion buffer,
+        // which is rasterized from the largest orbs that are close to the camera.
+        if (occlusionCullingEnabled && !prewarming) {
+            OUR_PROFILE_ZONE("occlusion culling");
+            cullOccludedCommands(VP, camera->getProjectionMatrix(windowSize), cameraPosition);
+        }
+        stats.visibleCommands = (int)(opaqueCommands.size() + transparentCommands.size());
+
+        // Comment:
+        // The normal matrices are only needed for the commands that will be drawn, so they are computed in one pass
+        // over each list after culling, instead of once per lit draw call (the aircraft isn't lit, so it doesn't need one).
+        // (A list may be empty, e.g. when nothing transparent is visible, and then it has no first command to point into).
+        for (std::vector<RenderCommand>* commands : {&opaqueCommands, &transparentCommands}) {
+            if (commands->empty()) continue;
+            RenderCommand& first = commands->front();
+            computeNormalMatrices(&first.localToWorld, &first.normalMatrix, commands->size(), sizeof(RenderCommand));
+        }
+        shadersWithFrameUniforms.clear();
+        this->selectActiveLights(world, cameraPosition);
+        stats.activeLights = (int)activeLights.size();
+        metrics::visibleLights.set(stats.activeLights);
+
+        // Comment:
+        // The far-away orbs are replaced by impostors, which are drawn after the opaque commands in one draw call.
+        // The camera right and up vectors are the first two columns of the inverse of the view matrix.
+        glm::mat4 inverseView = glm::inverse(camera->getViewMatrix());
+        glm::vec3 cameraRight = glm::normalize(glm::vec3(inverseView[0])), cameraUp = glm::normalize(glm::vec3(inverseView[1]));
+        impostors.clear();
+        if (impostors.isEnabled() && !prewarming) {
+            OUR_PROFILE_ZONE("impostor extraction");
+            extractImpostors(opaqueCommands, world, cameraPosition, cameraRight, cameraUp);
+            stats.impostors = (int)impostors.count();
+        }
+
+        // Comment:
+        // Then, the commands whose meshes have levels of detail get the level that fits their size on the screen.
+        // The projected radius (in pixels) of a sphere of radius r is r * P[1][1] * (height / 2) / w, where w is
+        // the clip space w of its center. The pixel scale is everything except r and w.
+        if (!lodPixelRadii.empty()) {
+            OUR_PROFILE_ZONE("lod selection");
+            float pixelScale = camera->getProjectionMatrix(windowSize)[1][1] * windowSize.y * 0.5f;
+            selectLODs(opaqueCommands, VP, pixelScale);
+            selectLODs(transparentCommands, VP, pixelScale);
+        }
+        
+        //DONE: (Req 9) Sort the transparent commands such that "first" is drawn before "second" if it is farther.
+        // Comment:
+        // Every command gets its squared distance to the camera once per frame (the square root doesn't change the order),
+        // and the depth sorter returns the back to front order, which is then applied to the commands.
+        {
+            OUR_PROFILE_ZONE("depth sort");
+            transparentDistances.resize(transparentCommands.size());
+            for (size_t index = 0; index < transparentCommands.size(); index++) {
+                glm::vec3 difference = cameraForward - transparentCommands[index].center;
+                transparentDistances[index] = glm::dot(difference, difference);
+            }
+            const std::vector<uint32_t>& transparentOrder = transparentSorter.sortBackToFront(transparentDistances);
+            sortedCommands.resize(transparentCommands.size());
+            for (size_t index = 0; index < transparentOrder.size(); index++) {
+                sortedCommands[index] = transparentCommands[transparentOrder[index]];
+            }
+            transparentCommands.swap(sortedCommands);
+        }
+
+        // If there is a postprocess effect, or the scene is drawn at a lower resolution (see "setQuality"), the scene is
+        // drawn into the scene target of the postprocessor (at the scene size). Otherwise, it is drawn directly to the default framebuffer.
+        postprocessor.setRenderScale(quality.renderScale);
+        bool postprocessing = postprocessor.isNeeded(postprocessInEffect, quality.postprocess);
+        glm::ivec2 viewportSize = postprocessing ? postprocessor.getSceneSize() : this->windowSize;
+
         //DONE: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
-        glViewport(0, 0, this->windowSize[0], this->windowSize[1]);
+        glViewport(0, 0, viewportSize[0], viewportSize[1]);
 
         //DONE: (Req 9) Set the clear color to black and the clear depth to 1
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -292,10 +387,10 @@ namespace our {
         glColorMask(true, true, true, true);
         glDepthMask(true);
 
-        // If there is a postprocess material, bind the framebuffer
-        if (postprocessInEffect != "-1") {
+        // If the scene goes through the postprocessor, bind its framebuffer (it is created the first time it is needed).
+        if (postprocessing) {
             //DONE: (Req 11) bind the framebuffer
-            glBindFramebuffer(GL_FRAMEBUFFER, this->postprocessFrameBuffer);
+            postprocessor.bindSceneTarget();
         }
 
         //DONE: (Req 9) Clear the color and depth buffers
@@ -305,51 +400,36 @@ namespace our {
         // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
         
         // Comment:
-        // This part is fairly simple. We loop over the opaque objects. For each object, 
-        // we setup the material, set relevant uniforms, depending on the material types. 
-        // Then, we draw the opaque mesh.
-        for (auto it = opaqueCommands.begin(); it != opaqueCommands.end(); it++) {
-            
-            // Obtaining the transform matrix, used for all materials except lit material.
-            glm::mat4 transform = VP * (*it).localToWorld;
-            ShaderProgram* currentShader = (*it).material->shader;
-            
-            // If it's a lit material, set the light-relevant uniforms.
-            if ( dynamic_cast<LitMaterial*>((*it).material) ) {
-                this->setupLitMaterial(&(*it), world, VP, cameraPosition);
+        // The order of the opaque commands does not matter, so we sort them by material then by mesh.
+        // This puts all the commands that share the same mesh and material next to each other, such that
+        // each group gets drawn with a single instanced draw call (e.g. all the planets that use the same planet material).
+        // It also reduces the number of state changes between the draw calls.
+        {
+            OUR_PROFILE_ZONE("opaque pass");
+            gpuTimers.begin("opaque pass");
+            if (instancingEnabled) {
+                std::sort(opaqueCommands.begin(), opaqueCommands.end(), [](const RenderCommand& first, const RenderCommand& second){
+                    if (first.material != second.material) return std::less<Material*>()(first.material, second.material);
+                    return std::less<Mesh*>()(first.mesh, second.mesh);
+                });
             }
-            
-            // If this is a gif-texture material, update the current frame if a certain duration has passed.
-            else if ( auto material = dynamic_cast<TexturedGIFMaterial*>((*it).material); material) {
-
-                currentShader->use();
-
-                if (glfwGetTime() - material->lastFrameTimeChange >= material->durationPerFrame) {
-                    material->lastFrameTimeChange = glfwGetTime();
-                    // We update the current frame, and wrap around if we reached the final frame. 
-                    material->currentFrame = (material->currentFrame == material->gif->textures.size()-1) ? 0 : material->currentFrame+1;
-                }
+            this->drawCommands(opaqueCommands, VP, cameraPosition);
 
-                // Setting up the material and using the shader.
-                (*it).material->setup();
-                currentShader->set("transform", transform);
-
-            } else {
-                // Otherwise, if it's a textured or a tinted material, just set the transform monolith matrix.
-                (*it).material->setup();
-                currentShader->set("transform", transform);
+            if (impostors.count() > 0) {
+                impostors.draw(VP, cameraRight, cameraUp);
+                stats.drawCalls++;
             }
-            (*it).mesh->draw();
-        }
 
-        // Only drawing the aircraft in case the FOV is the normal value.
-        // If speedup is in effect, don't draw the aircraft altogether.
-        if (camera->fovY < 2.0 && !gameConfig.movementRestriction.hideAircraft) {
-            glm::mat4 transform = VP * aircraftCommand.localToWorld;
-            aircraftCommand.material->shader->use();
-            aircraftCommand.material->setup();
-            aircraftCommand.material->shader->set("transform", transform);
-            aircraftCommand.mesh->draw();
+            // Only drawing the aircraft in case the FOV is the normal value.
+            // If speedup is in effect, don't draw the aircraft altogether.
+            if (camera->fovY < 2.0 && !gameConfig.movementRestriction.hideAircraft) {
+                glm::mat4 transform = VP * aircraftCommand.localToWorld;
+                aircraftCommand.material->shader->use();
+                aircraftCommand.material->setup();
+                aircraftCommand.material->shader->set("transform", transform);
+                aircraftCommand.mesh->draw();
+            }
+            gpuTimers.end();
         }
 
 
@@ -361,6 +441,8 @@ namespace our {
         // Obtains the sky model matrix. This matrix should translate every point with the "cameraForward" vector.
         // Now, this vector is created and explained above.
         if(this->skyMaterial){
+            OUR_PROFILE_ZONE("sky pass");
+            gpuTimers.begin("sky pass");
             //DONE: (Req 10) setup the sky material
             this->skyMaterial->setup();
             
@@ -392,6 +474,7 @@ namespace our {
             
             //DONE: (Req 10) draw the sky sphere
             this->skySphere->draw();
+            gpuTimers.end();
 
         }
 
@@ -399,37 +482,21 @@ namespace our {
         // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
         
         // Comment:
-        // This is the same as the above loop over the opaque objects.
-        for (auto it = transparentCommands.begin(); it != transparentCommands.end(); it++) {
-            glm::mat4 transform = VP * (*it).localToWorld;
-            (*it).material->shader->use();
-            (*it).material->setup();
-            (*it).material->shader->set("transform", transform);
-            (*it).mesh->draw();
+        // This is the same as the opaque objects, except that the commands are not reordered.
+        // Only consecutive commands (in the back to front order) that share the same mesh and material get instanced,
+        // so the blending order is preserved.
+        {
+            OUR_PROFILE_ZONE("transparent pass");
+            gpuTimers.begin("transparent pass");
+            this->drawCommands(transparentCommands, VP, cameraPosition);
+            gpuTimers.end();
         }
 
 
-        // If there is a postprocess material, apply postprocessing
-
-        // Comment:
-        // What we do in the following is:
-        // We unbind the framebuffer (thereby returning to the default framebuffer).
-        // We setup the postprocess material, use the shader, bind the vertex array to be used,
-        // bind the texture of the post process material, then we draw the vertex array.
-        // Note that: the data of the vertices (coordinates and texture coordinates) 
-        // actually lie in the shader: assets/shaders/fullscreen.vert (postprocessMaterial->shader)
-        // They are 3 vertices of a big triangle (bigger than the whole window).
-        if (postprocessInEffect != "-1"){
-
-            //DONE: (Req 11) Return to the default framebuffer
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
+        // If there is a postprocess effect, apply its chain of passes (the last one draws to the default framebuffer).
+        if (postprocessing){
             //DONE: (Req 11) Setup the postprocess material and draw the fullscreen triangle
-            postprocessMaterials[postprocessInEffect]->setup();
-            postprocessShaders[postprocessInEffect]->use();
-            glBindVertexArray(this->postProcessVertexArray);
-            postprocessMaterials[postprocessInEffect]->texture->bind();
-            glDrawArrays(GL_TRIANGLES, 0, 3);
+            postprocessor.apply(postprocessInEffect, quality.postprocess, gpuTimers);
         }
 
         // If the camera has tried to move into a forbidden zone, draw a red transparent plane
@@ -439,53 +506,426 @@ namespace our {
             forbiddenZoneMaterial->setup();
             forbiddenZoneMaterial->shader->use();
             glDrawArrays(GL_TRIANGLES, 0, 3);
+            metrics::drawCalls.add();
+        }
+
+        if (prewarming) prewarmFramesLeft--;
+    }
+
+    void ForwardRenderer::cullOccludedCommands(const glm::mat4& VP, const glm::mat4& projection, glm::vec3 cameraPosition) {
+        occlusionBuffer.begin(VP, projection, cameraPosition);
+
+        // Comment:
+        // The candidate occluders are the opaque commands drawing a solid sphere. Their inner radius is the smallest inner
+        // radius among all the levels of detail (so the occluder is hidden by whichever level gets drawn) scaled by the
+        // smallest scale of the object. The ones with the largest radius relative to their distance are picked.
+        occluderCandidates.clear();
+        for (const auto& command : opaqueCommands) {
+            if (occluderMeshes.count(command.mesh) == 0) continue;
+            float innerRadius = command.mesh->innerRadius;
+            for (auto lod : command.mesh->lods) innerRadius = std::min(innerRadius, lod->innerRadius);
+            float minScaleSquared = std::min(glm::dot(glm::vec3(command.localToWorld[0]), glm::vec3(command.localToWorld[0])),
+                                    std::min(glm::dot(glm::vec3(command.localToWorld[1]), glm::vec3(command.localToWorld[1])),
+                                             glm::dot(glm::vec3(command.localToWorld[2]), glm::vec3(command.localToWorld[2]))));
+            innerRadius *= glm::sqrt(minScaleSquared);
+
+            glm::vec3 center = glm::vec3(command.boundingSphere);
+            float distance = glm::distance(center, cameraPosition);
+            if (distance <= innerRadius) continue;
+            occluderCandidates.push_back({innerRadius / distance, glm::vec4(center, innerRadius)});
+        }
+        
+        size_t occluderCount = std::min(maxOccluders, occluderCandidates.size());
+        std::partial_sort(occluderCandidates.begin(), occluderCandidates.begin() + occluderCount, occluderCandidates.end(),
+            [](const auto& first, const auto& second){ return first.first > second.first; });
+        for (size_t index = 0; index < occluderCount; index++) {
+            occlusionBuffer.addOccluder(glm::vec3(occluderCandidates[index].second), occluderCandidates[index].second.w);
+        }
+        stats.occluders = (int)occlusionBuffer.occluderCount();
+        if (occlusionBuffer.occluderCount() == 0) return;
+
+        occlusionBuffer.rasterize();
+
+        // Test the bounding spheres of both lists (reusing the scratch buffers of the frustum culling), then compact them.
+        for (auto* commands : {&opaqueCommands, &transparentCommands}) {
+            cullingSpheres.resize(commands->size());
+            cullingResults.assign(commands->size(), 1);
+            for (size_t index = 0; index < commands->size(); index++) {
+                cullingSpheres[index] = (*commands)[index].boundingSphere;
+            }
+
+            stats.occludedCommands += (int)occlusionBuffer.testSpheres(cullingSpheres.data(), commands->size(), cullingResults.data());
+
+            size_t next = 0;
+            for (size_t index = 0; index < commands->size(); index++) {
+                if (cullingResults[index]) {
+                    if (next != index) (*commands)[next] = (*commands)[index];
+                    next++;
+                }
+            }
+            commands->resize(next);
+        }
+    }
+
+    void ForwardRenderer::extractImpostors(std::vector<RenderCommand>& commands, World* world, glm::vec3 cameraPosition, glm::vec3 cameraRight, glm::vec3 cameraUp) {
+        size_t next = 0;
+        for (size_t index = 0; index < commands.size(); index++) {
+            RenderCommand& command = commands[index];
+            glm::vec3 center = glm::vec3(command.boundingSphere);
+            float radius = command.boundingSphere.w;
+
+            // Commands that are near the camera (or can't be replaced) are kept in the list.
+            if (!impostors.canReplace(command.mesh, command.material) || glm::distance(center, cameraPosition) - radius < impostors.getDistance()) {
+                if (next != index) commands[next] = command;
+                next++;
+                continue;
+            }
+
+            // Comment:
+            // An impostor is lit by a single light, so we pick the light with the highest intensity at the orb's center.
+            // Spot lights are ignored since their cones are too narrow to light a whole orb, and the lights inside
+            // the orb itself (e.g. the moons' lights) are ignored since they don't light its surface from outside.
+            glm::vec3 toLight = glm::vec3(0.0f);
+            float intensity = 0.0f;
+            for (auto light : world->setOfLights) {
+                glm::vec3 direction;
+                float lightIntensity = glm::max(light->color.r, glm::max(light->color.g, light->color.b));
+                if (light->type == DIRECTIONAL) {
+                    direction = -glm::normalize(light->direction);
+                } else if (light->type == POINT) {
+                    direction = light->getOwner()->localTransform.position - center;
+                    float d = glm::length(direction);
+                    if (d <= radius) continue;
+                    direction /= d;
+                    lightIntensity /= glm::dot(light->attenuation, glm::vec3(d * d, d, 1.0f));
+                } else continue;
+
+                if (lightIntensity > intensity) {
+                    intensity = lightIntensity;
+                    toLight = direction;
+                }
+            }
+
+            impostors.add(command.material, command.boundingSphere, toLight, intensity, cameraPosition, cameraRight, cameraUp);
+        }
+        commands.resize(next);
+    }
+
+    void ForwardRenderer::selectLODs(std::vector<RenderCommand>& commands, const glm::mat4& VP, float pixelScale) {
+        for (auto& command : commands) {
+            if (!command.lodLevel || command.mesh->lods.empty()) continue;
+
+            // The clip space w of the bounding sphere center (the 4th row of VP dotted with the center).
+            glm::vec3 center = glm::vec3(command.boundingSphere);
+            float w = VP[0][3] * center.x + VP[1][3] * center.y + VP[2][3] * center.z + VP[3][3];
+            float radius = command.boundingSphere.w;
+
+            // If the camera is inside (or very close to) the sphere, the most detailed level is used.
+            int maxLevel = std::min(command.mesh->getLODCount() - 1, (int)lodPixelRadii.size());
+            int level = glm::clamp(*command.lodLevel, 0, maxLevel);
+            if (w <= radius) {
+                level = 0;
+            } else {
+                float pixelRadius = radius * pixelScale / w;
+                
+                // Starting from the last frame's level, we move to a finer level only if the radius is clearly above
+                // the threshold of the current level, and to a coarser level only if it is clearly below the next one.
+                while (level > 0 && pixelRadius > lodPixelRadii[level - 1] * (1.0f + lodHysteresis)) level--;
+                while (level < maxLevel && pixelRadius < lodPixelRadii[level] * (1.0f - lodHysteresis)) level++;
+            }
+
+            // The LOD bias of the quality settings is only added to the drawn level, so the hysteresis state isn't affected.
+            *command.lodLevel = level;
+            command.mesh = command.mesh->getLOD(level + quality.lodBias);
+        }
+    }
+
+    void ForwardRenderer::cullCommands(std::vector<RenderCommand>& commands, const Frustum& frustum) {
+        
+        // Gather the bounding spheres in one contiguous array so that they can be tested in batches.
+        cullingSpheres.resize(commands.size());
+        cullingResults.resize(commands.size());
+        for (size_t index = 0; index < commands.size(); index++) {
+            cullingSpheres[index] = commands[index].boundingSphere;
+        }
+
+        size_t visibleCount = cullSpheres(frustum, cullingSpheres.data(), commands.size(), cullingResults.data());
+        stats.culledCommands += (int)(commands.size() - visibleCount);
+
+        // Compact the visible commands to the front of the vector (keeping their order), then drop the rest.
+        size_t next = 0;
+        for (size_t index = 0; index < commands.size(); index++) {
+            if (cullingResults[index]) {
+                if (next != index) commands[next] = commands[index];
+                next++;
+            }
+        }
+        commands.resize(next);
+    }
+
+    void ForwardRenderer::drawCommands(std::vector<RenderCommand>& commands, glm::mat4 VP, glm::vec3 cameraPosition) {
+        size_t first = 0;
+        while (first < commands.size()) {
+            
+            // Find the end of the group of consecutive commands sharing the mesh and the material of the first one.
+            // (The prewarming frames enable the instancing then the multi-draw batches one at a time, see "render").
+            size_t last = first + 1;
+            if (instancingEnabled && prewarmFramesLeft < PREWARM_FRAMES) {
+                while (last < commands.size() && commands[last].mesh == commands[first].mesh && commands[last].material == commands[first].material)
+                    last++;
+            }
+
+            // Comment:
+            // If the commands sharing the material go on past this group (i.e. they use other meshes, like the levels of detail
+            // of the same model), the whole run of the material is submitted as one multi-draw batch instead.
+            // The commands stay in order, so this is also valid for the transparent commands.
+            if (multiDrawEnabled && prewarmFramesLeft < PREWARM_FRAMES - 1) {
+                size_t materialLast = last;
+                while (materialLast < commands.size() && commands[materialLast].material == commands[first].material)
+                    materialLast++;
+                if (materialLast > last && this->drawMultiDrawBatch(&commands[first], materialLast - first, VP, cameraPosition)) {
+                    first = materialLast;
+                    continue;
+                }
+            }
+
+            // A group of a single command is drawn normally, as well as the groups whose shaders can't be instanced.
+            if (last - first < 2 || !this->drawInstancedBatch(&commands[first], last - first, VP, cameraPosition)) {
+                for (size_t index = first; index < last; index++)
+                    this->drawCommand(commands[index], VP, cameraPosition);
+            }
+
+            first = last;
         }
     }
 
-    void ForwardRenderer::setupLitMaterial(RenderCommand* command, World* world, glm::mat4 VP, glm::vec3 cameraPosition) {
+    void ForwardRenderer::drawCommand(RenderCommand& command, glm::mat4 VP, glm::vec3 cameraPosition) {
+        // Obtaining the transform matrix, used for all materials except lit material.
+        glm::mat4 transform = VP * command.localToWorld;
+        ShaderProgram* currentShader = command.material->shader;
+        
+        // If it's a lit material, set the light-relevant uniforms.
+        if ( dynamic_cast<LitMaterial*>(command.material) ) {
+            this->setupLitMaterial(&command, VP, cameraPosition);
+        }
+        
+        // If this is a gif-texture material, update the current frame if a certain duration has passed.
+        else if ( auto material = dynamic_cast<TexturedGIFMaterial*>(command.material); material) {
+
+            currentShader->use();
+            material->updateFrame(our::getTime());
+
+            // Setting up the material and using the shader.
+            command.material->setup();
+            currentShader->set("transform", transform);
+
+        } else {
+            // Otherwise, if it's a textured or a tinted material, just set the transform monolith matrix.
+            command.material->setup();
+            currentShader->use();
+            currentShader->set("transform", transform);
+        }
+        command.mesh->draw();
+        stats.drawCalls++;
+        stats.triangles += command.mesh->getElementCount() / 3;
+    }
+
+    bool ForwardRenderer::drawInstancedBatch(const RenderCommand* commands, size_t count, glm::mat4 VP, glm::vec3 cameraPosition) {
+        Material* material = commands[0].material;
+        ShaderProgram* shader = material->shader;
+        ShaderProgram* instancedShader = shader->instancedVariant;
+        if (!instancedShader) return false;
+
+        // Comment:
+        // We fill the per-instance data: the model matrix, and the normal matrix which was computed after culling.
+        // Then, we upload them to the instance buffer.
+        // Re-specifying the whole buffer every time lets the driver orphan the old storage instead of waiting for
+        // the previous draw call that still reads from it.
+        instanceData.resize(count);
+        for (size_t index = 0; index < count; index++) {
+            instanceData[index].model = commands[index].localToWorld;
+            instanceData[index].normalMatrix = commands[index].normalMatrix;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+        metrics::bytesUploaded.add((int64_t)(count * sizeof(InstanceData)));
+
+        // Comment:
+        // The material sets its uniforms on its own shader, so we temporarily swap it with the instanced variant
+        // (which uses the same fragment shader, and thus the same uniforms), and restore it after drawing.
+        material->shader = instancedShader;
+        if (dynamic_cast<LitMaterial*>(material)) {
+            this->setupLitUniforms(material, VP, cameraPosition);
+        } else {
+            if (auto gifMaterial = dynamic_cast<TexturedGIFMaterial*>(material); gifMaterial)
+                gifMaterial->updateFrame(our::getTime());
+            material->setup();
+            instancedShader->use();
+            instancedShader->set("VP", VP);
+        }
+        commands[0].mesh->drawInstanced(instanceBuffer, (GLsizei)count);
+        material->shader = shader;
+
+        stats.drawCalls++;
+        stats.instancedBatches++;
+        stats.triangles += commands[0].mesh->getElementCount() / 3 * (int)count;
+        return true;
+    }
+
+    bool ForwardRenderer::drawMultiDrawBatch(const RenderCommand* commands, size_t count, glm::mat4 VP, glm::vec3 cameraPosition) {
+        Material* material = commands[0].material;
+        ShaderProgram* shader = material->shader;
+        ShaderProgram* multiDrawShader = shader->multiDrawVariant;
+        if (!multiDrawShader) return false;
+
+        // Comment:
+        // We fill the per-draw data and the arguments of every draw. All the meshes live in the mesh arena,
+        // so every draw is just a range of its element buffer and a base vertex, read through the same vertex array.
+        drawData.resize(count);
+        drawCounts.resize(count);
+        drawOffsets.resize(count);
+        drawBaseVertices.resize(count);
+        int triangles = 0;
+        for (size_t index = 0; index < count; index++) {
+            const RenderCommand& command = commands[index];
+            DrawData& data = drawData[index];
+            for (int column = 0; column < 4; column++) data.model[column] = command.localToWorld[column];
+            for (int column = 0; column < 3; column++) data.normalMatrix[column] = glm::vec4(command.normalMatrix[column], 0.0f);
+            drawCounts[index] = command.mesh->getElementCount();
+            drawOffsets[index] = (const void*)(command.mesh->getFirstIndex() * sizeof(GLuint));
+            drawBaseVertices[index] = command.mesh->getBaseVertex();
+            triangles += drawCounts[index] / 3;
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, drawDataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, count * sizeof(DrawData), drawData.data(), GL_STREAM_DRAW);
+        metrics::bytesUploaded.add((int64_t)(count * sizeof(DrawData)));
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        // The same swap as in "drawInstancedBatch" (the multi-draw variant uses the same fragment shader).
+        material->shader = multiDrawShader;
+        if (dynamic_cast<LitMaterial*>(material)) {
+            this->setupLitUniforms(material, VP, cameraPosition);
+        } else {
+            if (auto gifMaterial = dynamic_cast<TexturedGIFMaterial*>(material); gifMaterial)
+                gifMaterial->updateFrame(our::getTime());
+            material->setup();
+            multiDrawShader->use();
+            multiDrawShader->set("VP", VP);
+        }
+
+        // The draw data is bound to the last texture unit, which is never used by the materials.
+        glActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, drawDataTexture);
+        glActiveTexture(GL_TEXTURE0);
+        multiDrawShader->set("draw_data", (GLint)DRAW_DATA_TEXTURE_UNIT);
+
+        MeshArena::get().bind();
+        if (drawIDSupported) {
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), (GLsizei)count, drawBaseVertices.data());
+            stats.drawCalls++;
+            metrics::drawCalls.add();
+        } else {
+            for (size_t index = 0; index < count; index++) {
+                multiDrawShader->set("draw_id", (GLint)index);
+                glDrawElementsBaseVertex(GL_TRIANGLES, drawCounts[index], GL_UNSIGNED_INT, drawOffsets[index], drawBaseVertices[index]);
+            }
+            stats.drawCalls += (int)count;
+            metrics::drawCalls.add((int64_t)count);
+        }
+        material->shader = shader;
+
+        stats.multiDrawBatches++;
+        stats.triangles += triangles;
+        return true;
+    }
+
+    void ForwardRenderer::setupLitMaterial(RenderCommand* command, glm::mat4 VP, glm::vec3 cameraPosition) {
+
+        this->setupLitUniforms((*command).material, VP, cameraPosition);
+
+        // Setting the M matrix and the (precomputed) M_IT normal matrix for use in the lit.vert shader.
+        (*command).material->shader->set("M", (*command).localToWorld);
+        (*command).material->shader->set("M_IT", (*command).normalMatrix);
+    }
+
+    void ForwardRenderer::selectActiveLights(World* world, glm::vec3 cameraPosition) {
+        activeLights.assign(world->setOfLights.begin(), world->setOfLights.end());
+        if (quality.maxLights < 0 || activeLights.size() <= (size_t)quality.maxLights) return;
+
+        // Comment:
+        // The directional lights light everything, so they come first. The rest are ordered by their distance to the camera,
+        // since the nearest lights affect most of what is visible (and the farthest ones are the least noticeable when dropped).
+        auto priority = [cameraPosition](LightComponent* light) {
+            if (light->type == DIRECTIONAL) return -1.0f;
+            glm::vec3 difference = light->getOwner()->localTransform.position - cameraPosition;
+            return glm::dot(difference, difference);
+        };
+        std::partial_sort(activeLights.begin(), activeLights.begin() + quality.maxLights, activeLights.end(),
+            [&priority](LightComponent* first, LightComponent* second) { return priority(first) < priority(second); });
+        activeLights.resize(quality.maxLights);
+    }
+
+    void ForwardRenderer::setupLitUniforms(Material* material, glm::mat4 VP, glm::vec3 cameraPosition) {
 
         // Setting up the material and using the shader.
-        (*command).material->setup();
-        (*command).material->shader->use();
+        material->setup();
+        material->shader->use();
+
+        // The rest of the uniforms are the same for all the lit draw calls of the frame,
+        // so we only send them the first time this shader is used in the frame.
+        if (std::find(shadersWithFrameUniforms.begin(), shadersWithFrameUniforms.end(), material->shader) != shadersWithFrameUniforms.end()) return;
+        shadersWithFrameUniforms.push_back(material->shader);
 
-        // First, setting the number of all light sources within the world.
-        (*command).material->shader->set("light_count", (int)world->setOfLights.size());
+        // First, setting the number of the light sources used in this frame (see "selectActiveLights").
+        material->shader->set("light_count", (int)activeLights.size());
 
         // Setting sky colors. We are in space, there's no sense in making one different
         // than the other, so I made them all blackish gray.
-        (*command).material->shader->set("sky.top", glm::vec3(0.3f, 0.3f, 0.3f));
-        (*command).material->shader->set("sky.horizon", glm::vec3(0.3f, 0.3f, 0.3f));
-        (*command).material->shader->set("sky.bottom", glm::vec3(0.3f, 0.3f, 0.3f));
+        material->shader->set("sky.top", glm::vec3(0.3f, 0.3f, 0.3f));
+        material->shader->set("sky.horizon", glm::vec3(0.3f, 0.3f, 0.3f));
+        material->shader->set("sky.bottom", glm::vec3(0.3f, 0.3f, 0.3f));
         
+        // Building the names of the uniforms of the light indices that weren't used before (see "lightUniformNames").
+        while (lightUniformNames.size() < activeLights.size()) {
+            int index = (int)lightUniformNames.size();
+            lightUniformNames.push_back({
+                our::string_format("lights[%d].type", index),
+                our::string_format("lights[%d].color", index),
+                our::string_format("lights[%d].attenuation", index),
+                our::string_format("lights[%d].cone_angles", index),
+                our::string_format("lights[%d].direction", index),
+                our::string_format("lights[%d].position", index)
+            });
+        }
+
         int i = 0;
 
-        // Looping over all existent lights components.
-        for (auto lightIterator = world->setOfLights.begin(); lightIterator != world->setOfLights.end(); lightIterator++) {
+        // Looping over the active lights components.
+        for (auto lightIterator = activeLights.begin(); lightIterator != activeLights.end(); lightIterator++) {
+            const LightUniformNames& names = lightUniformNames[i];
 
             // Setting the light's parameters: the type, color, attenuation, and cone_angles. 
-            (*command).material->shader->set( our::string_format("lights[%d].type", i), (int)(*lightIterator)->type);
-            (*command).material->shader->set(our::string_format("lights[%d].color", i), (*lightIterator)->color);
-            (*command).material->shader->set(our::string_format("lights[%d].attenuation", i), (*lightIterator)->attenuation);
-            (*command).material->shader->set(our::string_format("lights[%d].cone_angles", i), (*lightIterator)->cone_angles);
+            material->shader->set(names.type, (int)(*lightIterator)->type);
+            material->shader->set(names.color, (*lightIterator)->color);
+            material->shader->set(names.attenuation, (*lightIterator)->attenuation);
+            material->shader->set(names.coneAngles, (*lightIterator)->cone_angles);
             
             // Setting the light's position and direction.
             // The direction is something internal to the light component in case of a SPOT light and a directional light.
             // In the case of a point light, it's calculated in the shaders.
             // We get the position from the parent entity.
-            (*command).material->shader->set(our::string_format("lights[%d].direction", i), (*lightIterator)->direction);
-            (*command).material->shader->set(our::string_format("lights[%d].position", i), (*lightIterator)->getOwner()->localTransform.position);
+            material->shader->set(names.direction, (*lightIterator)->direction);
+            material->shader->set(names.position, (*lightIterator)->getOwner()->localTransform.position);
 
             i++;
 
         }
 
-        // Setting the M matrix, M_IT matrix, and VP matrix for use in the lit.vert shader.
-        (*command).material->shader->set("M", (*command).localToWorld);
-        (*command).material->shader->set("M_IT",  glm::transpose(glm::inverse((*command).localToWorld)));
-        (*command).material->shader->set("VP", VP);
+        // Setting the VP matrix for use in the lit.vert shader.
+        material->shader->set("VP", VP);
         
         // Setting the camera position.
-        (*command).material->shader->set("camera_position", cameraPosition);
+        material->shader->set("camera_position", cameraPosition);
 
 
     }
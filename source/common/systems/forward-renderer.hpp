@@ -4,6 +4,16 @@
 #include "../components/camera.hpp"
 #include "../components/mesh-renderer.hpp"
 #include "../asset-loader.hpp"
+#include "frustum-culling.hpp"
+#include "impostors.hpp"
+#include "occlusion-culling.hpp"
+#include "normal-matrices.hpp"
+#include "depth-sort.hpp"
+#include "render-proxies.hpp"
+#include "command-generation.hpp"
+#include "postprocessor.hpp"
+#include "gpu-timers.hpp"
+#include "../quality-governor.hpp"
 #include "components/light.hpp"
 #include "material/material.hpp"
 #include "mesh/multiple-meshes.hpp"
@@ -15,20 +25,37 @@
 #include <unordered_set>
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "../states/extra-definitions.hpp"
 
 namespace our
 {
     
-    // The render command stores command that tells the renderer that it should draw
-    // the given mesh at the given localToWorld matrix using the given material
-    // The renderer will fill this struct using the mesh renderer components
-    struct RenderCommand {
-        glm::mat4 localToWorld;
-        glm::vec3 center;
-        Mesh* mesh;
-        Material* material;
+    // This struct holds statistics collected by the renderer while drawing a frame.
+    // They are reset at the start of every call to "render".
+    struct RenderStats {
+        int visibleCommands = 0; // The number of commands that passed the culling tests and got drawn
+        int culledCommands = 0;  // The number of commands rejected by the frustum culling
+        int occludedCommands = 0; // The number of commands rejected by the occlusion culling
+        int occluders = 0;       // The number of occluders rasterized into the occlusion buffer
+        int drawCalls = 0;       // The number of draw calls issued for the commands (an instanced batch counts as one)
+        int instancedBatches = 0; // The number of draw calls that were instanced
+        int multiDrawBatches = 0; // The number of batches of commands submitted together using the per-draw data
+        int triangles = 0;       // The number of triangles drawn for the commands
+        int impostors = 0;       // The number of commands drawn as impostors (all of them in one draw call)
+        int updatedProxies = 0;  // The number of render proxies updated in this frame (in the retained mode)
+        int activeLights = 0;    // The number of lights used by the lit materials (see "QualitySettings::maxLights")
+    };
+
+    // The texture unit the draw data of the multi-draw batches is bound to (the materials use the first units).
+    #define DRAW_DATA_TEXTURE_UNIT 15
+
+    // The per-draw data of a command drawn in a multi-draw batch, as it is stored in the draw data texture buffer.
+    // Every column is a texel (RGBA32F) so the vertex shader can fetch them; the w of the normal matrix columns is unused.
+    struct DrawData {
+        glm::vec4 model[4];
+        glm::vec4 normalMatrix[3];
     };
 
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
@@ -43,15 +70,99 @@ namespace our
         std::vector<RenderCommand> opaqueCommands;
         std::vector<RenderCommand> transparentCommands;
 
+        // Whether the commands should be tested against the camera frustum before drawing them.
+        bool frustumCullingEnabled = true;
+        // The number of frames left that draw every command to prewarm the shaders (see "render").
+        int prewarmFramesLeft = 0;
+        // Scratch buffers used by the frustum culling (kept here to avoid reallocating them every frame).
+        std::vector<glm::vec4> cullingSpheres;
+        std::vector<uint8_t> cullingResults;
+
+        // The statistics of the last rendered frame.
+        RenderStats stats;
+
+        // Whether the commands are kept between frames in the render proxies (and only updated when they change)
+        // instead of being rebuilt from all the entities every frame.
+        bool retainedEnabled = false;
+        RenderProxies renderProxies;
+
+        // Orders the transparent commands from back to front, reusing the previous frame's order when it is still nearly sorted.
+        DepthSorter transparentSorter;
+        // Scratch buffers holding the squared distance of every transparent command, and the commands after sorting.
+        std::vector<float> transparentDistances;
+        std::vector<RenderCommand> sortedCommands;
+
+        // The shaders whose per-frame uniforms (lights, sky, VP and camera position) were already set in this frame.
+        // Uniforms are part of the program state, so they only need to be sent once per shader per frame.
+        // It is a vector searched linearly (there are only a few lit shaders), which keeps its memory when it is cleared
+        // every frame (a set would free its nodes and allocate them again).
+        std::vector<ShaderProgram*> shadersWithFrameUniforms;
+
+        // The names of the uniforms of every light index ("lights[i].type", etc.). They are built the first time an index
+        // is used, instead of formatting (and allocating) them for every light every frame.
+        struct LightUniformNames {
+            std::string type, color, attenuation, coneAngles, direction, position;
+        };
+        std::vector<LightUniformNames> lightUniformNames;
+
+        // The worker threads used by the CPU-side stages of the renderer (the command generation and the occlusion culling).
+        std::unique_ptr<ThreadPool> workerPool;
+        // Builds the commands from the entities on the worker threads (when the retained mode is off).
+        CommandGenerator commandGenerator;
+
+        // Whether the commands should be tested against a CPU depth buffer rasterized from the largest nearby orbs.
+        bool occlusionCullingEnabled = false;
+        OcclusionBuffer occlusionBuffer;
+        // Only the commands that draw these meshes (solid spheres) can be used as occluders.
+        std::unordered_set<Mesh*> occluderMeshes;
+        // The maximum number of occluders rasterized per frame (the ones with the largest projected size are picked).
+        size_t maxOccluders = 16;
+        // Scratch buffer holding the candidate occluders (projected size, world center and inner radius).
+        std::vector<std::pair<float, glm::vec4>> occluderCandidates;
+
+        // Whether consecutive commands sharing the same mesh and material should be drawn using a single instanced draw call.
+        // The opaque commands are sorted by material and mesh to group them together.
+        bool instancingEnabled = true;
+        // The buffer holding the per-instance data of the batch being drawn, and its copy on the RAM.
+        GLuint instanceBuffer = 0;
+        std::vector<InstanceData> instanceData;
+
+        // Comment:
+        // Whether consecutive commands sharing the same material but not the same mesh should be submitted together.
+        // Their model and normal matrices are packed into a texture buffer that the multi-draw variant of the material shader
+        // indexes by the draw ID, so the batch needs no per-draw uniforms. If the draw ID is supported (ARB_shader_draw_parameters),
+        // the batch is one glMultiDrawElementsBaseVertex call; otherwise, it is a loop of draw calls that only set "draw_id".
+        bool multiDrawEnabled = true;
+        bool drawIDSupported = false;
+        GLuint drawDataBuffer = 0, drawDataTexture = 0;
+        std::vector<DrawData> drawData;
+        // The arguments of the multi-draw call (the element count, the byte offset of the first element, and the base vertex of every draw).
+        std::vector<GLsizei> drawCounts;
+        std::vector<const void*> drawOffsets;
+        std::vector<GLint> drawBaseVertices;
+
+        // The screen-space radii (in pixels) below which the objects switch to the next coarser level of detail.
+        // Level i is used when the projected radius is between lodPixelRadii[i] and lodPixelRadii[i-1].
+        std::vector<float> lodPixelRadii;
+        // The fraction by which the projected radius must go past a threshold before switching the level.
+        // This prevents objects near a threshold from flickering between two levels.
+        float lodHysteresis = 0.15f;
+
+        // The billboards that replace the far-away orbs.
+        Impostors impostors;
+
         // Objects used for rendering a skybox
         Mesh* skySphere;
         TexturedMaterial* skyMaterial;
+        // The quality knobs of the current frame (see "setQuality").
+        QualitySettings quality;
+        // The lights used by the lit materials in this frame (all the lights, unless the quality settings limit their count).
+        std::vector<LightComponent*> activeLights;
+
         // Objects used for Postprocessing
-        GLuint postprocessFrameBuffer, postProcessVertexArray;
-        Texture2D *colorTarget, *depthTarget;
-        
-        std::unordered_map<std::string, ShaderProgram*> postprocessShaders;
-        std::unordered_map<std::string, TexturedMaterial*> postprocessMaterials;
+        Postprocessor postprocessor;
+        // Measures the GPU time of the passes: the opaque, sky and transparent passes, and the postprocess passes.
+        GPUTimers gpuTimers;
 
         // Forbidden zone material and vertex array. 
         GLuint forbiddenVertexArray;
@@ -64,9 +175,59 @@ namespace our
         // Clean up the renderer
         void destroy();
         // This function should be called every frame to draw the given world
-        void render(World* world, bool forbiddenAccess, our::GameConfig gameConfig);
+        void render(World* world, bool forbiddenAccess, const our::GameConfig& gameConfig);
+
+        void setupLitMaterial(RenderCommand* command, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Sets the quality knobs used from the next frame on (they are picked by the quality governor of the application).
+        void setQuality(const QualitySettings& settings) { quality = settings; }
+
+        // Fills "activeLights" with the lights used in this frame: all of them, or the most important ones if the quality
+        // settings limit their count.
+        void selectActiveLights(World* world, glm::vec3 cameraPosition);
+
+        // Sets up the given lit material and sets all the uniforms that are shared by the objects using it
+        // (the lights, the sky, VP and the camera position). The model matrices are not set.
+        void setupLitUniforms(Material* material, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Draws the given commands in order. Consecutive commands that share the same mesh and material are
+        // drawn as one instanced batch if instancing is enabled and the material shader has an instanced variant.
+        // Consecutive commands that share the same material but use different meshes are drawn as one multi-draw batch
+        // if multi-draw is enabled and the material shader has a multi-draw variant.
+        void drawCommands(std::vector<RenderCommand>& commands, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Draws a single command using the material shader and the uniforms of its type.
+        void drawCommand(RenderCommand& command, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Draws "count" commands sharing the same mesh and material with one instanced draw call.
+        // Returns false (without drawing anything) if the material shader has no instanced variant.
+        bool drawInstancedBatch(const RenderCommand* commands, size_t count, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Draws "count" commands sharing the same material (in order) using the per-draw data.
+        // Returns false (without drawing anything) if the material shader has no multi-draw variant.
+        bool drawMultiDrawBatch(const RenderCommand* commands, size_t count, glm::mat4 VP, glm::vec3 cameraPosition);
+
+        // Rasterizes the largest occluders among the opaque commands, then removes the hidden commands from both lists.
+        void cullOccludedCommands(const glm::mat4& VP, const glm::mat4& projection, glm::vec3 cameraPosition);
+
+        // Moves the commands that are far enough and can be replaced by impostors from the given list to the impostors queue.
+        void extractImpostors(std::vector<RenderCommand>& commands, World* world, glm::vec3 cameraPosition, glm::vec3 cameraRight, glm::vec3 cameraUp);
+
+        // Replaces the mesh of every command that has levels of detail with the level that fits its projected radius on the screen.
+        // "pixelScale" converts a (world) radius at a clip space w of 1 into pixels.
+        void selectLODs(std::vector<RenderCommand>& commands, const glm::mat4& VP, float pixelScale);
+
+        // Removes the commands whose bounding spheres lie completely outside the given frustum.
+        // The order of the remaining commands is preserved.
+        void cullCommands(std::vector<RenderCommand>& commands, const Frustum& frustum);
+
+        // Returns the statistics of the last rendered frame.
+        const RenderStats& getStats() const { return stats; }
 
-        void setupLitMaterial(RenderCommand* command, World* world, glm::mat4 VP, glm::vec3 cameraPosition);
+        // Returns the GPU time (in milliseconds) of every pass measured in the last few frames.
+        const std::vector<std::pair<const char*, float>>& getGPUTimes() { return gpuTimers.getTimes(); }
+        // The timers can be used to measure the GPU time of other passes of the frame (after "render" returns, e.g. the text).
+        GPUTimers& getGPUTimers() { return gpuTimers; }
 
         std::string postprocessInEffect = "-1";
     };
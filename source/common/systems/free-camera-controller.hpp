@@ -5,6 +5,7 @@
 #include "../components/free-camera-controller.hpp"
 
 #include "../application.hpp"
+#include "../profiler.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -33,7 +34,8 @@ namespace our
         // forbiddenAccess: returns whether the camera has tried to enter a forbidden zone, so that we may
         // draw a red screen indicating that the zone is forbidden.
         // updatedPosition: the updated position of the camera.
-        Entity* update(World* world, float deltaTime, glm::vec3* updatedPosition, bool *forbiddenAccess, our::GameConfig gameConfig, float timeSinceSpeedCollected) {
+        Entity* update(World* world, float deltaTime, glm::vec3* updatedPosition, bool *forbiddenAccess, const our::GameConfig& gameConfig, float timeSinceSpeedCollected) {
+            OUR_PROFILE_ZONE("camera controller");
             // First of all, we search for an entity containing both a CameraComponent and a FreeCameraControllerComponent
             // As soon as we find one, we break
             CameraComponent* camera = nullptr;
@@ -58,9 +60,10 @@ namespace our
                 mouse_locked = false;
             }
 
-            // We get a reference to the entity's position and rotation
+            // We get a reference to the entity's position and rotation (which are changed below, so the change is reported)
             glm::vec3& position = entity->localTransform.position;
             glm::vec3& rotation = entity->localTransform.rotation;
+            entity->markTransformChanged();
 
             // If the left mouse button is pressed, we get the change in the mouse location
             // and use it to update the camera rotation
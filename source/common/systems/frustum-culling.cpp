@@ -0,0 +1,95 @@
+#include "frustum-culling.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OUR_FRUSTUM_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace our {
+
+    Frustum Frustum::fromViewProjection(const glm::mat4& VP) {
+        // GLM matrices are column-major, so we read the rows manually.
+        auto row = [&VP](int index) {
+            return glm::vec4(VP[0][index], VP[1][index], VP[2][index], VP[3][index]);
+        };
+        glm::vec4 row0 = row(0), row1 = row(1), row2 = row(2), row3 = row(3);
+
+        Frustum frustum;
+        frustum.planes[0] = row3 + row0; // Left
+        frustum.planes[1] = row3 - row0; // Right
+        frustum.planes[2] = row3 + row1; // Bottom
+        frustum.planes[3] = row3 - row1; // Top
+        frustum.planes[4] = row3 + row2; // Near
+        frustum.planes[5] = row3 - row2; // Far
+
+        // Normalize the planes such that the plane equation gives the signed distance.
+        for (auto& plane : frustum.planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    size_t cullSpheres(const Frustum& frustum, const glm::vec4* spheres, size_t count, uint8_t* visible) {
+        size_t visibleCount = 0;
+        size_t index = 0;
+
+#if defined(OUR_FRUSTUM_CULLING_SSE)
+        // Comment:
+        // We process 4 spheres at a time. The spheres are stored as an array of structures (x, y, z, r),
+        // so we transpose each group of 4 into a structure of arrays (xxxx, yyyy, zzzz, rrrr).
+        // Then, for every plane, we compute the 4 signed distances at once and compare them with -radius.
+        // A sphere is outside if it is completely behind any of the planes.
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++) {
+            planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+            planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+            planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+            planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+        }
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; index + 4 <= count; index += 4) {
+            __m128 x = _mm_loadu_ps(&spheres[index + 0].x);
+            __m128 y = _mm_loadu_ps(&spheres[index + 1].x);
+            __m128 z = _mm_loadu_ps(&spheres[index + 2].x);
+            __m128 r = _mm_loadu_ps(&spheres[index + 3].x);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            __m128 negativeRadius = _mm_sub_ps(zero, r);
+
+            // Each lane stays all ones as long as the sphere is not completely outside of any plane.
+            __m128 inside = _mm_cmpeq_ps(zero, zero);
+            for (int p = 0; p < 6; p++) {
+                __m128 distance = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                    _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p])
+                );
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; lane++) {
+                visible[index + lane] = (mask >> lane) & 1;
+                visibleCount += visible[index + lane];
+            }
+        }
+#endif
+
+        // The remaining spheres (or all of them if SSE is not available) are tested one by one.
+        for (; index < count; index++) {
+            glm::vec3 center = glm::vec3(spheres[index]);
+            float radius = spheres[index].w;
+            uint8_t inside = 1;
+            for (const auto& plane : frustum.planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    inside = 0;
+                    break;
+                }
+            }
+            visible[index] = inside;
+            visibleCount += inside;
+        }
+
+        return visibleCount;
+    }
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace our {
+
+    // A frustum is defined by 6 planes (left, right, bottom, top, near, far).
+    // Each plane is stored as (a, b, c, d) where a point p is on the inner side of the plane if: dot(abc, p) + d >= 0
+    // The planes are normalized so that dot(abc, p) + d gives the signed distance from the plane, which is what
+    // we need to test bounding spheres against the frustum.
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Extracts the frustum planes (in the world space) from the given view-projection matrix.
+        // This is known as the Gribb-Hartmann method.
+        static Frustum fromViewProjection(const glm::mat4& VP);
+    };
+
+    // Tests "count" bounding spheres against the frustum. Each sphere is stored as a vec4 where
+    // xyz is the center (in the world space) and w is the radius.
+    // The result is written to "visible" where visible[i] = 1 if the i-th sphere intersects or lies inside
+    // the frustum, and 0 if it is completely outside of it.
+    // The spheres are tested in batches of 4 using SSE (when available), so the function is meant
+    // to be called once per frame with all the spheres instead of once per sphere.
+    // Returns the number of visible spheres.
+    size_t cullSpheres(const Frustum& frustum, const glm::vec4* spheres, size_t count, uint8_t* visible);
+
+    // Transforms a bounding sphere from the local space to the world space using the given local to world matrix.
+    // The radius is scaled by the largest scale along any axis so that the sphere stays conservative for non-uniform scales.
+    inline glm::vec4 transformBoundingSphere(const glm::mat4& localToWorld, glm::vec3 center, float radius) {
+        glm::vec3 worldCenter = glm::vec3(localToWorld * glm::vec4(center, 1.0f));
+        float maxScaleSquared = glm::max(
+            glm::dot(glm::vec3(localToWorld[0]), glm::vec3(localToWorld[0])),
+            glm::max(
+                glm::dot(glm::vec3(localToWorld[1]), glm::vec3(localToWorld[1])),
+                glm::dot(glm::vec3(localToWorld[2]), glm::vec3(localToWorld[2]))
+            )
+        );
+        return glm::vec4(worldCenter, radius * glm::sqrt(maxScaleSquared));
+    }
+
+}
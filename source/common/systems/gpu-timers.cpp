@@ -0,0 +1,65 @@
+#include "gpu-timers.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    void GPUTimers::newFrame() {
+        frame++;
+    }
+
+    void GPUTimers::begin(std::string_view name) {
+        auto it = std::find_if(sections.begin(), sections.end(), [name](const Section& section) { return section.name == name; });
+        if (it == sections.end()) {
+            sections.emplace_back();
+            sections.back().name = name;
+            sections.back().label = Profiler::intern(sections.back().name);
+            sections.back().counterName = Profiler::intern("GPU " + sections.back().name);
+            glGenQueries(FRAMES_IN_FLIGHT, sections.back().queries);
+            it = sections.end() - 1;
+        }
+        Section& section = *it;
+
+        // The query in this slot was issued FRAMES_IN_FLIGHT frames ago, so its result should be ready by now.
+        // If it isn't, the result is dropped (the query is simply issued again below).
+        int slot = frame % FRAMES_IN_FLIGHT;
+        if (section.pending[slot]) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(section.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(section.queries[slot], GL_QUERY_RESULT, &nanoseconds);
+                if (section.warmedUp) {
+                    section.milliseconds = nanoseconds * 1e-6f;
+                    if (Profiler::isEnabled()) Profiler::recordCounter(section.counterName, section.milliseconds);
+                }
+                section.warmedUp = true;
+            }
+        }
+        glBeginQuery(GL_TIME_ELAPSED, section.queries[slot]);
+        section.pending[slot] = true;
+        section.lastFrame = frame;
+        running = true;
+    }
+
+    void GPUTimers::end() {
+        if (!running) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        running = false;
+    }
+
+    const std::vector<std::pair<const char*, float>>& GPUTimers::getTimes() {
+        times.clear();
+        for (const auto& section : sections) {
+            if (frame - section.lastFrame < FRAMES_IN_FLIGHT) times.emplace_back(section.label, section.milliseconds);
+        }
+        return times;
+    }
+
+    void GPUTimers::destroy() {
+        for (auto& section : sections) glDeleteQueries(FRAMES_IN_FLIGHT, section.queries);
+        sections.clear();
+        times.clear();
+    }
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glad/gl.h>
+#include "../profiler.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace our {
+
+    // Measures the GPU time of named sections of a frame using GL_TIME_ELAPSED queries.
+    // Comment:
+    // The result of a query is only available after the GPU executes the commands it wraps, which is usually a frame or two
+    // later. So every section has a ring of queries, one per frame in flight, and a query is only read back when its slot is
+    // about to be reused, by which time its result is usually ready. If it isn't (the GPU is more than FRAMES_IN_FLIGHT frames
+    // behind), the result is dropped instead of waiting for it, so reading the times never stalls the CPU.
+    // The reported times are thus a few frames old, which is fine for profiling.
+    // While the profiler is enabled, every result is also added to the trace as a counter named "GPU <section>" (see "profiler.hpp").
+    // Time elapsed queries can't be nested, so a section must end before the next one begins.
+    class GPUTimers {
+        static const int FRAMES_IN_FLIGHT = 4;
+
+        struct Section {
+            std::string name;
+            const char* label = nullptr;       // The (interned) name returned by "getTimes"
+            const char* counterName = nullptr; // The (interned) name of the counter of this section in the profiler trace
+            GLuint queries[FRAMES_IN_FLIGHT] = {};
+            bool pending[FRAMES_IN_FLIGHT] = {};
+            // The first result of a section is dropped, since it can include the lazy initialization of the driver
+            // (e.g. llvmpipe reports a huge time for the first query of a context).
+            bool warmedUp = false;
+            float milliseconds = 0.0f;
+            // The frame in which this section was last measured (sections that stop being used are not reported).
+            unsigned int lastFrame = 0;
+        };
+        // The sections are searched linearly by name (there are only a few), so beginning a section never allocates.
+        std::vector<Section> sections;
+        std::vector<std::pair<const char*, float>> times;
+        unsigned int frame = 0;
+        bool running = false;
+
+    public:
+        // Starts a new frame. Must be called once per frame before any section begins.
+        void newFrame();
+
+        // Starts measuring the section with the given name.
+        void begin(std::string_view name);
+        // Stops measuring the current section.
+        void end();
+
+        // Returns the last known time (in milliseconds) of every section measured in the last few frames, in the order they were first measured.
+        // The names stay valid until the program exits (they are interned by the profiler).
+        const std::vector<std::pair<const char*, float>>& getTimes();
+
+        // Deletes all the queries.
+        void destroy();
+    };
+
+}
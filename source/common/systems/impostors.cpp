@@ -0,0 +1,224 @@
+#include "impostors.hpp"
+#include "../asset-loader.hpp"
+#include "../components/light.hpp"
+#include "../metrics.hpp"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+namespace our {
+
+    void Impostors::initialize(const nlohmann::json& config) {
+        enabled = config.value("enabled", true);
+        if (!enabled) return;
+
+        distance = config.value("distance", 60.0f);
+        lightingAngles = glm::max(config.value("lighting-angles", 5), 1);
+        int tileSize = config.value("tile-size", 128);
+
+        // The impostors are baked using the most detailed level of the mesh.
+        mesh = AssetLoader<Mesh>::get(config.value("mesh", "sphere"));
+        std::vector<Material*> materials;
+        for (auto& name : config.value("materials", std::vector<std::string>())) {
+            if (Material* material = AssetLoader<Material>::get(name); material) {
+                rows[material] = (int)materials.size();
+                materials.push_back(material);
+            } else {
+                std::cerr << "WARNING:: IMPOSTOR MATERIAL NOT FOUND: " << name << std::endl;
+            }
+        }
+        if (!mesh || materials.empty()) {
+            std::cerr << "WARNING:: IMPOSTORS ARE DISABLED SINCE THERE IS NO MESH OR MATERIALS TO BAKE." << std::endl;
+            rows.clear();
+            enabled = false;
+            return;
+        }
+
+        // Comment:
+        // Here, we create the atlas with a full chain of mipmaps, since the impostors are, by definition, small on the screen.
+        // Then, we attach it (with a temporary depth texture) to a framebuffer and render the sprites into it tile by tile.
+        // The tiles don't overlap, so the whole atlas is cleared once (with alpha = 0 outside of the spheres).
+        atlasTiles = glm::ivec2(1 + lightingAngles, (int)materials.size());
+        glm::ivec2 atlasSize = atlasTiles * tileSize;
+        int levels = 1 + (int)glm::floor(glm::log2((float)glm::max(atlasSize.x, atlasSize.y)));
+
+        atlas = new Texture2D();
+        atlas->bind();
+        glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, atlasSize.x, atlasSize.y);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        Texture2D* depth = new Texture2D();
+        depth->bind();
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, atlasSize.x, atlasSize.y);
+
+        GLuint frameBuffer;
+        glGenFramebuffers(1, &frameBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas->getOpenGLName(), 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth->getOpenGLName(), 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Impostor atlas framebuffer is not complete!" << std::endl;
+
+        glColorMask(true, true, true, true);
+        glDepthMask(true);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClearDepth(1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        rowIsLit.assign(materials.size(), false);
+        for (size_t row = 0; row < materials.size(); row++) bake(materials[row], (int)row, tileSize);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &frameBuffer);
+        delete depth;
+
+        atlas->bind();
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        // The shader and the vertex array used to draw the impostors.
+        // The vertex array has no vertex buffer; only the instance buffer (the quad corners are generated in the shader).
+        shader = new ShaderProgram();
+        shader->attach("assets/shaders/impostor.vert", GL_VERTEX_SHADER);
+        shader->attach("assets/shaders/impostor.frag", GL_FRAGMENT_SHADER);
+        shader->link();
+
+        glGenVertexArrays(1, &vertexArray);
+        glGenBuffers(1, &instanceBuffer);
+        glBindVertexArray(vertexArray);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void *)offsetof(ImpostorInstance, centerRadius));
+            glVertexAttribDivisor(0, 1);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ImpostorInstance), (void *)offsetof(ImpostorInstance, tile));
+            glVertexAttribDivisor(1, 1);
+        glBindVertexArray(0);
+
+        // The impostors are opaque (the pixels outside of the sphere are discarded), and are visible from both sides.
+        pipelineState.depthTesting.enabled = true;
+        pipelineState.faceCulling.enabled = false;
+
+        std::cout << "Baked impostors for " << materials.size() << " materials (" << atlasSize.x << "x" << atlasSize.y << " atlas)." << std::endl;
+    }
+
+    void Impostors::bake(Material* material, int row, int tileSize) {
+        // Comment:
+        // The sphere is looked at from the +z axis using an orthographic camera that fits the sphere with some padding.
+        // In this space, the camera right is +x and the camera up is +y, which is how the quads are oriented at runtime.
+        float radius = mesh->boundingSphereRadius;
+        glm::vec3 cameraPosition = mesh->boundingSphereCenter + glm::vec3(0.0f, 0.0f, 3.0f * radius);
+        glm::mat4 view = glm::lookAt(cameraPosition, mesh->boundingSphereCenter, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::ortho(-1.1f * radius, 1.1f * radius, -1.1f * radius, 1.1f * radius, radius, 5.0f * radius);
+        glm::mat4 VP = projection * view;
+
+        // Only lit materials react to the light direction. Other materials only get the unlit column.
+        bool lit = dynamic_cast<LitMaterial*>(material) != nullptr;
+        rowIsLit[row] = lit;
+        int columns = lit ? 1 + lightingAngles : 1;
+
+        for (int column = 0; column < columns; column++) {
+            glViewport(column * tileSize, row * tileSize, tileSize, tileSize);
+
+            if (lit) {
+                material->setup();
+                ShaderProgram* shader = material->shader;
+                shader->use();
+
+                // The same sky colors used by the forward renderer.
+                shader->set("sky.top", glm::vec3(0.3f, 0.3f, 0.3f));
+                shader->set("sky.horizon", glm::vec3(0.3f, 0.3f, 0.3f));
+                shader->set("sky.bottom", glm::vec3(0.3f, 0.3f, 0.3f));
+
+                // Column 0 has no light. Column i has a directional light coming from the right side
+                // at an angle of (i-1) * pi / (lightingAngles - 1) from the view direction.
+                if (column == 0) {
+                    shader->set("light_count", 0);
+                } else {
+                    float angle = lightingAngles > 1 ? (column - 1) * glm::pi<float>() / (lightingAngles - 1) : 0.0f;
+                    glm::vec3 toLight = glm::vec3(glm::sin(angle), 0.0f, glm::cos(angle));
+                    shader->set("light_count", 1);
+                    shader->set("lights[0].type", (int)DIRECTIONAL);
+                    shader->set("lights[0].color", glm::vec3(1.0f));
+                    shader->set("lights[0].direction", -toLight);
+                    shader->set("lights[0].attenuation", glm::vec3(0.0f, 0.0f, 1.0f));
+                    shader->set("lights[0].cone_angles", glm::vec2(0.0f));
+                    shader->set("lights[0].position", glm::vec3(0.0f));
+                }
+
+                shader->set("M", glm::mat4(1.0f));
+                shader->set("M_IT", glm::mat3(1.0f));
+                shader->set("VP", VP);
+                shader->set("camera_position", cameraPosition);
+            } else {
+                material->setup();
+                material->shader->use();
+                material->shader->set("transform", VP);
+            }
+
+            mesh->draw();
+        }
+    }
+
+    void Impostors::destroy() {
+        if (atlas) delete atlas;
+        if (shader) delete shader;
+        if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+        if (instanceBuffer) glDeleteBuffers(1, &instanceBuffer);
+        atlas = nullptr;
+        shader = nullptr;
+        vertexArray = instanceBuffer = 0;
+        rows.clear();
+        instances.clear();
+        enabled = false;
+    }
+
+    void Impostors::add(Material* material, glm::vec4 boundingSphere, glm::vec3 toLight, float intensity,
+                        glm::vec3 cameraPosition, glm::vec3 cameraRight, glm::vec3 cameraUp) {
+        int row = rows.at(material);
+        glm::vec3 center = glm::vec3(boundingSphere);
+
+        // Pick the lit column whose lighting angle is the closest to the angle between the camera and the light,
+        // and the rotation that makes the right side of the sprite (the lit side) face the light on the screen.
+        float column = 0.0f, rotation = 0.0f;
+        if (rowIsLit[row] && intensity > 0.0f) {
+            glm::vec3 toCamera = glm::normalize(cameraPosition - center);
+            float angle = glm::acos(glm::clamp(glm::dot(toLight, toCamera), -1.0f, 1.0f));
+            column = 1.0f + (lightingAngles > 1 ? glm::round(angle / glm::pi<float>() * (lightingAngles - 1)) : 0.0f);
+            rotation = glm::atan(glm::dot(toLight, cameraUp), glm::dot(toLight, cameraRight));
+        } else {
+            intensity = 0.0f;
+        }
+
+        instances.push_back({boundingSphere, glm::vec4((float)row, column, rotation, glm::clamp(intensity, 0.0f, 1.0f))});
+    }
+
+    void Impostors::draw(const glm::mat4& VP, glm::vec3 cameraRight, glm::vec3 cameraUp) {
+        if (instances.empty()) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(ImpostorInstance), instances.data(), GL_STREAM_DRAW);
+        metrics::bytesUploaded.add((int64_t)(instances.size() * sizeof(ImpostorInstance)));
+
+        pipelineState.setup();
+        shader->use();
+        shader->set("VP", VP);
+        shader->set("camera_right", cameraRight);
+        shader->set("camera_up", cameraUp);
+        shader->set("tile_size", glm::vec2(1.0f) / glm::vec2(atlasTiles));
+
+        // The materials bind their samplers to unit 0, so we unbind it to use the atlas own filtering parameters.
+        glActiveTexture(GL_TEXTURE0);
+        atlas->bind();
+        glBindSampler(0, 0);
+        shader->set("atlas", 0);
+
+        glBindVertexArray(vertexArray);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)instances.size());
+        metrics::drawCalls.add();
+    }
+
+}
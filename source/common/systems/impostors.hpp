@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../material/material.hpp"
+#include "../mesh/mesh.hpp"
+#include "../shader/shader.hpp"
+#include "../texture/texture2d.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // The per-instance data of an impostor (see "assets/shaders/impostor.vert").
+    struct ImpostorInstance {
+        glm::vec4 centerRadius; // The world position of the orb center (xyz) and its radius (w)
+        glm::vec4 tile;         // The atlas row (x), the lit atlas column (y), the rotation on the screen (z) and the light intensity (w)
+    };
+
+    // Impostors are camera-facing quads that are drawn instead of far-away spheres.
+    // When initialized, every configured material is rendered on a sphere into an atlas of sprites:
+    // - Each row of the atlas belongs to one material.
+    // - The first column holds the sprite without any light (ambient and emissive only).
+    // - The other columns hold the sprite lit by a single directional light (of intensity 1) at increasing
+    //   angles from the view direction (from fully lit to back-lit). The light always comes from the right side of the tile.
+    // At runtime, the sprite whose lighting angle is the closest to the angle between the camera and the orb's
+    // strongest light is picked, rotated on the screen such that its lit side faces the light, and mixed with the
+    // unlit sprite by the light intensity. All the impostors are drawn in one instanced draw call.
+    class Impostors {
+        bool enabled = false;
+        // The distance from the camera beyond which the orbs are drawn as impostors.
+        float distance = 60.0f;
+        // The mesh that the impostors replace (only commands drawing this mesh are replaced).
+        Mesh* mesh = nullptr;
+        // The atlas row of every material that has impostors.
+        std::unordered_map<Material*, int> rows;
+        // The number of lighting angles (lit columns) in the atlas, and whether each row was lit when baked.
+        int lightingAngles = 0;
+        std::vector<bool> rowIsLit;
+
+        Texture2D* atlas = nullptr;
+        glm::ivec2 atlasTiles = glm::ivec2(0);
+        ShaderProgram* shader = nullptr;
+        GLuint vertexArray = 0, instanceBuffer = 0;
+        PipelineState pipelineState;
+
+        // The impostors queued for drawing in the current frame.
+        std::vector<ImpostorInstance> instances;
+
+        // Renders the sprites of the given material into its row of the atlas.
+        void bake(Material* material, int row, int tileSize);
+
+    public:
+        // Reads the configuration and bakes the atlas. The configuration should be in the form:
+        //    { "enabled": true, "distance": 60, "mesh": "sphere", "tile-size": 128, "lighting-angles": 5,
+        //      "materials": ["planet-1", "planet-2", "star", "moon"] }
+        // This must be called after the assets are loaded.
+        void initialize(const nlohmann::json& config);
+        void destroy();
+
+        bool isEnabled() const { return enabled; }
+        float getDistance() const { return distance; }
+
+        // Returns true if the given mesh and material can be drawn as an impostor.
+        bool canReplace(Mesh* mesh, Material* material) const {
+            return enabled && mesh == this->mesh && rows.count(material) != 0;
+        }
+
+        // Clears the impostors queued in the last frame.
+        void clear() { instances.clear(); }
+        // Makes room for the given number of impostors, so queueing them doesn't allocate.
+        void reserve(size_t count) { instances.reserve(count); }
+
+        // Queues an impostor for the given bounding sphere (in the world space).
+        // "toLight" is the normalized direction from the orb to its strongest light, and "intensity" is that light's intensity
+        // at the orb. "cameraPosition", "cameraRight" and "cameraUp" define the camera in the world space.
+        void add(Material* material, glm::vec4 boundingSphere, glm::vec3 toLight, float intensity,
+                 glm::vec3 cameraPosition, glm::vec3 cameraRight, glm::vec3 cameraUp);
+
+        // Returns the number of impostors queued in the current frame.
+        size_t count() const { return instances.size(); }
+
+        // Draws all the queued impostors using one instanced draw call.
+        void draw(const glm::mat4& VP, glm::vec3 cameraRight, glm::vec3 cameraUp);
+    };
+
+}
@@ -2,6 +2,7 @@
 
 #include "../ecs/world.hpp"
 #include "../components/movement.hpp"
+#include "../profiler.hpp"
 #include "GLFW/glfw3.h"
 
 #include <glm/glm.hpp>
@@ -21,6 +22,7 @@ namespace our
 
         // This should be called every frame to update all entities containing a MovementComponent. 
         void update(World* world, float deltaTime) {
+            OUR_PROFILE_ZONE("movement");
             // For each entity in the world
             for(auto entity : world->getEntities()){
                 // Get the movement component if it exists
@@ -30,6 +32,7 @@ namespace our
                     // Change the position and rotation based on the linear & angular velocity and delta time.
                     entity->localTransform.position += deltaTime * movement->linearVelocity;
                     entity->localTransform.rotation += deltaTime * movement->angularVelocity;
+                    entity->markTransformChanged();
                 }
             }
         }
@@ -0,0 +1,93 @@
+#include "normal-matrices.hpp"
+
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OUR_NORMAL_MATRICES_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace our {
+
+    // The relative tolerance under which the columns are considered equally long and perpendicular.
+    static const float UNIFORM_SCALE_TOLERANCE = 1e-4f;
+
+    // Computes the normal matrix of a single model matrix, using the shortcut if it has a uniform scale.
+    static inline void computeNormalMatrix(const glm::mat4& model, glm::mat3& normal) {
+        glm::mat3 linear = glm::mat3(model);
+        float length0 = glm::dot(linear[0], linear[0]), length1 = glm::dot(linear[1], linear[1]), length2 = glm::dot(linear[2], linear[2]);
+        float tolerance = UNIFORM_SCALE_TOLERANCE * length0;
+        bool uniform = length0 > 0.0f
+            && glm::abs(length1 - length0) <= tolerance && glm::abs(length2 - length0) <= tolerance
+            && glm::abs(glm::dot(linear[0], linear[1])) <= tolerance
+            && glm::abs(glm::dot(linear[0], linear[2])) <= tolerance
+            && glm::abs(glm::dot(linear[1], linear[2])) <= tolerance;
+        normal = uniform ? linear * (1.0f / length0) : glm::inverseTranspose(linear);
+    }
+
+    void computeNormalMatrices(const glm::mat4* models, glm::mat3* normals, size_t count, size_t stride) {
+        const uint8_t* input = reinterpret_cast<const uint8_t*>(models);
+        uint8_t* output = reinterpret_cast<uint8_t*>(normals);
+        auto model = [&](size_t index) -> const glm::mat4& { return *reinterpret_cast<const glm::mat4*>(input + index * stride); };
+        auto normal = [&](size_t index) -> glm::mat3& { return *reinterpret_cast<glm::mat3*>(output + index * stride); };
+
+        size_t index = 0;
+#if defined(OUR_NORMAL_MATRICES_SSE)
+        // Comment:
+        // The matrices are processed 4 at a time. The same column of the 4 matrices is transposed such that every
+        // register holds one component (x, y or z) of that column for all 4 matrices, so the squared lengths and the
+        // dot products of the columns of the 4 matrices are computed together. The matrices that fail the uniform scale
+        // test (which is rare) fall back to the general inverse one by one.
+        const __m128 relativeTolerance = _mm_set1_ps(UNIFORM_SCALE_TOLERANCE);
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        for (; index + 4 <= count; index += 4) {
+            __m128 x[3], y[3], z[3];
+            __m128 columns[4][3];
+            for (int column = 0; column < 3; column++) {
+                for (int lane = 0; lane < 4; lane++) columns[lane][column] = _mm_loadu_ps(&model(index + lane)[column][0]);
+                __m128 r0 = columns[0][column], r1 = columns[1][column], r2 = columns[2][column], r3 = columns[3][column];
+                _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                x[column] = r0; y[column] = r1; z[column] = r2;
+            }
+            auto dot = [&](int a, int b) {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(x[a], x[b]), _mm_mul_ps(y[a], y[b])), _mm_mul_ps(z[a], z[b]));
+            };
+            __m128 length0 = dot(0, 0);
+            __m128 tolerance = _mm_mul_ps(relativeTolerance, length0);
+            auto small = [&](__m128 value) { return _mm_cmple_ps(_mm_andnot_ps(signMask, value), tolerance); };
+
+            __m128 uniform = _mm_cmpgt_ps(length0, _mm_setzero_ps());
+            uniform = _mm_and_ps(uniform, small(_mm_sub_ps(dot(1, 1), length0)));
+            uniform = _mm_and_ps(uniform, small(_mm_sub_ps(dot(2, 2), length0)));
+            uniform = _mm_and_ps(uniform, small(dot(0, 1)));
+            uniform = _mm_and_ps(uniform, small(dot(0, 2)));
+            uniform = _mm_and_ps(uniform, small(dot(1, 2)));
+            int mask = _mm_movemask_ps(uniform);
+
+            // For s * R, the normal matrix is the matrix itself divided by s^2.
+            alignas(16) float factors[4];
+            _mm_store_ps(factors, _mm_div_ps(_mm_set1_ps(1.0f), length0));
+            for (int lane = 0; lane < 4; lane++) {
+                glm::mat3& result = normal(index + lane);
+                if (!(mask & (1 << lane))) {
+                    result = glm::inverseTranspose(glm::mat3(model(index + lane)));
+                    continue;
+                }
+                // A mat3 is 9 contiguous floats, so the first two columns are stored with 4-wide stores (the 4th float of
+                // each store is overwritten by the next column), and the last one is stored through a temporary.
+                __m128 factor = _mm_set1_ps(factors[lane]);
+                _mm_storeu_ps(&result[0][0], _mm_mul_ps(columns[lane][0], factor));
+                _mm_storeu_ps(&result[1][0], _mm_mul_ps(columns[lane][1], factor));
+                alignas(16) float last[4];
+                _mm_store_ps(last, _mm_mul_ps(columns[lane][2], factor));
+                result[2] = glm::vec3(last[0], last[1], last[2]);
+            }
+        }
+#endif
+        // The remaining matrices (or all of them, without SSE) are handled one by one.
+        for (; index < count; index++) computeNormalMatrix(model(index), normal(index));
+    }
+
+}
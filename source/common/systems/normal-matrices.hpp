@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace our {
+
+    // Computes the normal matrix (the inverse transpose of the upper 3x3 part) of "count" model matrices.
+    // The matrices are read from "models" and written to "normals", advancing both pointers by "stride" bytes
+    // per matrix, so the pass can run directly over an array of structs (e.g. the render commands).
+    // Comment:
+    // Almost every transform in the game is a rotation with a uniform scale (M = s * R), whose normal matrix is
+    // simply M / s^2, so the general inverse is only computed for the matrices that are sheared or non-uniformly scaled.
+    void computeNormalMatrices(const glm::mat4* models, glm::mat3* normals, size_t count, size_t stride);
+
+    // Computes the normal matrix of a single model matrix (see "computeNormalMatrices").
+    inline glm::mat3 computeNormalMatrix(const glm::mat4& model) {
+        glm::mat3 normal;
+        computeNormalMatrices(&model, &normal, 1, 0);
+        return normal;
+    }
+
+}
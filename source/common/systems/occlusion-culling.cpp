@@ -0,0 +1,156 @@
+#include "occlusion-culling.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OUR_OCCLUSION_CULLING_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace our {
+
+    // The number of spheres tested by every job, and the number of rows rasterized by every job.
+    static const size_t SPHERES_PER_JOB = 64;
+    static const int ROWS_PER_JOB = 8;
+
+    void OcclusionBuffer::initialize(glm::ivec2 resolution, ThreadPool* pool) {
+        this->resolution = glm::max(resolution, glm::ivec2(4));
+        this->stride = (this->resolution.x + 3) & ~3;
+        this->depth.assign((size_t)stride * this->resolution.y, std::numeric_limits<float>::infinity());
+        this->pool = pool;
+    }
+
+    void OcclusionBuffer::begin(const glm::mat4& VP, const glm::mat4& projection, glm::vec3 cameraPosition) {
+        this->VP = VP;
+        this->cameraPosition = cameraPosition;
+        this->pixelScale = glm::vec2(projection[0][0], projection[1][1]) * glm::vec2(resolution) * 0.5f;
+        occluders.clear();
+    }
+
+    void OcclusionBuffer::addOccluder(glm::vec3 center, float innerRadius) {
+        glm::vec4 clip = VP * glm::vec4(center, 1.0f);
+        float distance = glm::distance(center, cameraPosition);
+        if (clip.w <= 0.0f || distance <= innerRadius) return;
+
+        // Comment:
+        // The projection of a sphere is an ellipse whose smallest radius is (at least) radius / distance in the
+        // normalized units, so an ellipse with these radii around the projected center is covered by the sphere.
+        // Away from the screen center, the projected center drifts slightly from the center of the projection,
+        // so we shrink the ellipse by a small margin to stay conservative.
+        // Its depth is the depth of the sphere center, which is behind the whole visible (front) half of the sphere.
+        Ellipse ellipse;
+        ellipse.center = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(resolution);
+        ellipse.radius = 0.9f * innerRadius / distance * pixelScale;
+        ellipse.depth = clip.w;
+
+        // Tiny occluders can't hide anything meaningful, so we skip them.
+        if (ellipse.radius.x < 1.0f || ellipse.radius.y < 1.0f) return;
+        occluders.push_back(ellipse);
+    }
+
+    void OcclusionBuffer::rasterize() {
+        std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::infinity());
+        if (occluders.empty()) return;
+
+        size_t jobs = (resolution.y + ROWS_PER_JOB - 1) / ROWS_PER_JOB;
+        auto job = [this](size_t index) {
+            int firstRow = (int)index * ROWS_PER_JOB;
+            rasterizeRows(firstRow, std::min(firstRow + ROWS_PER_JOB, resolution.y));
+        };
+        if (pool) pool->run(jobs, job);
+        else for (size_t index = 0; index < jobs; index++) job(index);
+    }
+
+    void OcclusionBuffer::rasterizeRows(int firstRow, int lastRow) {
+        for (const Ellipse& ellipse : occluders) {
+            // Only the rows whose centers lie inside the ellipse are filled.
+            int top = std::max(firstRow, (int)glm::ceil(ellipse.center.y - ellipse.radius.y - 0.5f));
+            int bottom = std::min(lastRow - 1, (int)glm::floor(ellipse.center.y + ellipse.radius.y - 0.5f));
+
+            for (int y = top; y <= bottom; y++) {
+                float dy = (y + 0.5f - ellipse.center.y) / ellipse.radius.y;
+                float halfWidth = ellipse.radius.x * glm::sqrt(glm::max(0.0f, 1.0f - dy * dy));
+                int left = std::max(0, (int)glm::ceil(ellipse.center.x - halfWidth - 0.5f));
+                int right = std::min(resolution.x - 1, (int)glm::floor(ellipse.center.x + halfWidth - 0.5f));
+                if (left > right) continue;
+
+                float* row = &depth[(size_t)y * stride];
+                int x = left;
+#if defined(OUR_OCCLUSION_CULLING_SSE)
+                // Keep the nearest depth of every pixel, 4 pixels at a time.
+                __m128 value = _mm_set1_ps(ellipse.depth);
+                for (; x + 4 <= right + 1; x += 4) {
+                    _mm_storeu_ps(row + x, _mm_min_ps(_mm_loadu_ps(row + x), value));
+                }
+#endif
+                for (; x <= right; x++) row[x] = std::min(row[x], ellipse.depth);
+            }
+        }
+    }
+
+    bool OcclusionBuffer::isOccluded(glm::vec4 sphere) const {
+        if (occluders.empty()) return false;
+
+        // Comment:
+        // We project the 8 corners of the box around the sphere to find a screen rectangle that surely contains it,
+        // and the nearest depth it can have. If any corner is behind the camera, the sphere is considered visible.
+        glm::vec2 minimum = glm::vec2(std::numeric_limits<float>::max());
+        glm::vec2 maximum = glm::vec2(std::numeric_limits<float>::lowest());
+        float nearest = std::numeric_limits<float>::max();
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 offset = glm::vec3((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = VP * glm::vec4(glm::vec3(sphere) + offset * sphere.w, 1.0f);
+            if (clip.w <= 1e-4f) return false;
+            glm::vec2 pixel = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * glm::vec2(resolution);
+            minimum = glm::min(minimum, pixel);
+            maximum = glm::max(maximum, pixel);
+            nearest = std::min(nearest, clip.w);
+        }
+
+        int left = std::max(0, (int)glm::floor(minimum.x)), right = std::min(resolution.x - 1, (int)glm::ceil(maximum.x));
+        int top = std::max(0, (int)glm::floor(minimum.y)), bottom = std::min(resolution.y - 1, (int)glm::ceil(maximum.y));
+        if (left > right || top > bottom) return false;
+
+        // The sphere is hidden only if every pixel of its rectangle has an occluder in front of its nearest depth.
+        for (int y = top; y <= bottom; y++) {
+            const float* row = &depth[(size_t)y * stride];
+            int x = left;
+#if defined(OUR_OCCLUSION_CULLING_SSE)
+            __m128 value = _mm_set1_ps(nearest);
+            for (; x + 4 <= right + 1; x += 4) {
+                if (_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row + x), value)) != 0xF) return false;
+            }
+#endif
+            for (; x <= right; x++) {
+                if (!(row[x] < nearest)) return false;
+            }
+        }
+        return true;
+    }
+
+    size_t OcclusionBuffer::testSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible) {
+        if (occluders.empty() || count == 0) return 0;
+
+        // Every job tests a chunk of the spheres and counts the hidden ones in its own slot.
+        size_t jobs = (count + SPHERES_PER_JOB - 1) / SPHERES_PER_JOB;
+        if (hiddenCounts.size() < jobs) hiddenCounts.resize(jobs);
+        std::fill_n(hiddenCounts.begin(), jobs, 0);
+        auto job = [&](size_t index) {
+            size_t first = index * SPHERES_PER_JOB, last = std::min(first + SPHERES_PER_JOB, count);
+            for (size_t sphere = first; sphere < last; sphere++) {
+                if (visible[sphere] && isOccluded(spheres[sphere])) {
+                    visible[sphere] = 0;
+                    hiddenCounts[index]++;
+                }
+            }
+        };
+        if (pool) pool->run(jobs, job);
+        else for (size_t index = 0; index < jobs; index++) job(index);
+
+        size_t total = 0;
+        for (size_t index = 0; index < jobs; index++) total += hiddenCounts[index];
+        return total;
+    }
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "../thread-pool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // A low resolution depth buffer rasterized on the CPU from a few large occluders, which is then used to
+    // reject the objects that are completely hidden behind them before sending them to the GPU.
+    // The occluders are spheres that are solid inside (e.g. planets), and they are rasterized as screen-space
+    // ellipses (one per occluder) at the depth of their center, which is always behind their visible surface.
+    // The depth stored in the buffer is the clip space w (the view depth for a perspective camera).
+    // Rasterization splits the rows across the thread pool, and testing splits the objects across it.
+    class OcclusionBuffer {
+        struct Ellipse {
+            glm::vec2 center; // In pixels
+            glm::vec2 radius; // In pixels
+            float depth;
+        };
+
+        glm::ivec2 resolution = glm::ivec2(0);
+        // The width of a row in the buffer, rounded up to a multiple of 4 so every row starts 16-byte aligned.
+        int stride = 0;
+        std::vector<float> depth;
+        ThreadPool* pool = nullptr;
+
+        glm::mat4 VP = glm::mat4(1.0f);
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+        // Converts a radius at a distance of 1 into pixels (along x and y).
+        glm::vec2 pixelScale = glm::vec2(0.0f);
+        std::vector<Ellipse> occluders;
+        // The number of hidden spheres counted by every job of "testSpheres".
+        // It only grows, so the tests don't allocate once it is large enough.
+        std::vector<size_t> hiddenCounts;
+
+        void rasterizeRows(int firstRow, int lastRow);
+
+    public:
+        // Allocates the buffer. The pool (which may be null) is used to split the work across threads.
+        void initialize(glm::ivec2 resolution, ThreadPool* pool);
+
+        glm::ivec2 getResolution() const { return resolution; }
+
+        // Starts a new frame with the given camera matrices and clears the occluders.
+        void begin(const glm::mat4& VP, const glm::mat4& projection, glm::vec3 cameraPosition);
+
+        // Adds an occluder given its center and inner radius in the world space.
+        // It is ignored if the camera is inside it or if it is behind the camera.
+        void addOccluder(glm::vec3 center, float innerRadius);
+
+        // Returns the number of occluders added since "begin".
+        size_t occluderCount() const { return occluders.size(); }
+
+        // Clears the buffer and rasterizes all the added occluders.
+        void rasterize();
+
+        // Tests "count" bounding spheres (xyz: center, w: radius in the world space) against the buffer.
+        // visible[i] is set to 0 if the i-th sphere is completely hidden and left untouched otherwise.
+        // Returns the number of hidden spheres.
+        size_t testSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible);
+
+        // Returns true if the given bounding sphere is completely hidden by the rasterized occluders.
+        bool isOccluded(glm::vec4 sphere) const;
+    };
+
+}
@@ -0,0 +1,287 @@
+#include "postprocessor.hpp"
+#include "../texture/texture-utils.hpp"
+#include "../shader/shader.hpp"
+#include "../profiler.hpp"
+#include "../metrics.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace our {
+
+    // Reads the whole file at the given path (returns an empty string if it can't be opened).
+    static std::string readSource(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) return std::string();
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // A fragment shader that copies its input (upsampling it if it is smaller than the target).
+    static const char* COPY_SHADER =
+        "#version 330\nuniform sampler2D tex;\nin vec2 tex_coord;\nout vec4 frag_color;\n"
+        "void main(){ frag_color = texture(tex, tex_coord); }\n";
+
+    void Postprocessor::initialize(glm::ivec2 size, const nlohmann::json& effects) {
+        this->size = this->sceneSize = size;
+
+        // Create a vertex array to use for drawing the texture
+        glGenVertexArrays(1, &vertexArray);
+
+        // Create a sampler to use for sampling the scene texture in the post processing shader
+        sampler = new Sampler();
+        sampler->set(GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        sampler->set(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        sampler->set(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // The pass used to upsample the scene to the window when the render scale is below 1 and no effect is applied.
+        upsamplePasses.push_back({"upsample", createMaterial(COPY_SHADER, true)});
+
+        for (auto& [name, desc] : effects.items()) {
+            std::vector<PostprocessPass>& passes = chains[name];
+
+            // The per-pixel effects waiting to be fused (their names and sources).
+            std::vector<std::string> fusedNames, fusedSources;
+            auto flush = [&]() {
+                if (fusedSources.empty()) return;
+                std::string passName = fusedNames[0];
+                for (size_t index = 1; index < fusedNames.size(); index++) passName += " + " + fusedNames[index];
+                passes.push_back({passName, createMaterial(fuseEffects(fusedSources), true)});
+                fusedNames.clear();
+                fusedSources.clear();
+            };
+
+            for (auto& effect : desc.is_array() ? desc : nlohmann::json::array({desc})) {
+                std::string path = effect.is_object() ? effect.value("shader", "") : effect.get<std::string>();
+                std::string source = readSource(path);
+                bool identity = effect.is_object() && effect.contains("identity") ? effect["identity"].get<bool>() : isIdentityShader(source);
+                if (identity) continue;
+
+                std::string effectName = path.substr(path.find_last_of("/\\") + 1);
+                float scale = effect.is_object() ? glm::clamp(effect.value("scale", 1.0f), 0.0625f, 1.0f) : 1.0f;
+                int iterations = effect.is_object() ? std::max(effect.value("iterations", 1), 1) : 1;
+                bool fuse = effect.is_object() ? effect.value("fuse", true) : true;
+                if (fuse && scale == 1.0f && iterations == 1 && isPerPixelShader(source)) {
+                    fusedNames.push_back(effectName);
+                    fusedSources.push_back(source);
+                } else {
+                    flush();
+                    PostprocessPass pass = {effectName, createMaterial(path, false)};
+                    pass.scale = scale;
+                    pass.iterations = iterations;
+                    passes.push_back(pass);
+                }
+            }
+            flush();
+
+            // The output of a scaled (or iterated) pass is in its own targets, so if it is the last one, it is copied
+            // (and upsampled) to the default framebuffer by an extra pass.
+            if (!passes.empty() && (passes.back().scale < 1.0f || passes.back().iterations > 1)) {
+                passes.push_back({"upsample", createMaterial(COPY_SHADER, true)});
+            }
+        }
+    }
+
+    TexturedMaterial* Postprocessor::createMaterial(const std::string& shaderSource, bool generated) {
+        // Create the post processing shader
+        ShaderProgram* shader = new ShaderProgram();
+        shader->attach("assets/shaders/fullscreen.vert", GL_VERTEX_SHADER);
+        if (generated) shader->attachSource(shaderSource, GL_FRAGMENT_SHADER, "<fused postprocess effects>");
+        else shader->attach(shaderSource, GL_FRAGMENT_SHADER);
+        shader->link();
+
+        // Create a post processing material
+        TexturedMaterial* material = new TexturedMaterial();
+        material->shader = shader;
+        material->texture = nullptr;
+        material->sampler = sampler;
+        // The default options are fine but we don't need to interact with the depth buffer
+        // so it is more performant to disable the depth mask
+        material->pipelineState.depthMask = false;
+        return material;
+    }
+
+    std::string Postprocessor::fuseEffects(const std::vector<std::string>& sources) {
+        if (sources.size() == 1) return sources[0];
+
+        // Comment:
+        // Every effect is pasted (without its #version line) between a define and an undef of "per_pixel",
+        // which renames its function to "per_pixel_i". Then, main calls all of them in order.
+        std::string fused = "#version 330\n#define POSTPROCESS_FUSED\n";
+        std::string calls;
+        for (size_t index = 0; index < sources.size(); index++) {
+            std::string source = sources[index];
+            if (size_t version = source.find("#version"); version != std::string::npos)
+                source.erase(version, source.find('\n', version) - version);
+            std::string function = "per_pixel_" + std::to_string(index);
+            fused += "#define per_pixel " + function + "\n" + source + "\n#undef per_pixel\n";
+            calls += "    color = " + function + "(color, tex_coord);\n";
+        }
+        fused += "uniform sampler2D tex;\nin vec2 tex_coord;\nout vec4 frag_color;\n"
+                 "void main(){\n    vec4 color = texture(tex, tex_coord);\n" + calls + "    frag_color = color;\n}\n";
+        return fused;
+    }
+
+    bool Postprocessor::isIdentityShader(const std::string& source) {
+        // Comment:
+        // We drop the comments, the preprocessor lines (e.g. #version) and all the whitespace, then compare what is left
+        // to a shader that only samples the scene texture. Anything else (even an equivalent shader written differently)
+        // is treated as a real effect, which is always correct, just not as fast.
+        std::string stripped;
+        for (size_t index = 0; index < source.size(); index++) {
+            if (source.compare(index, 2, "//") == 0 || source[index] == '#') {
+                while (index < source.size() && source[index] != '\n') index++;
+            } else if (source.compare(index, 2, "/*") == 0) {
+                index = source.find("*/", index + 2);
+                if (index == std::string::npos) break;
+                index++;
+            } else if (!std::isspace((unsigned char)source[index])) {
+                stripped += source[index];
+            }
+        }
+        return stripped == "uniformsampler2Dtex;invec2tex_coord;outvec4frag_color;voidmain(){frag_color=texture(tex,tex_coord);}";
+    }
+
+    bool Postprocessor::isPerPixelShader(const std::string& source) {
+        return source.find("#ifndef POSTPROCESS_FUSED") != std::string::npos && source.find("per_pixel(") != std::string::npos;
+    }
+
+    bool Postprocessor::isActive(const std::string& name) const {
+        auto chain = chains.find(name);
+        return chain != chains.end() && !chain->second.empty();
+    }
+
+    void Postprocessor::createTarget(PostprocessTarget& target, glm::ivec2 size, Texture2D* depth) {
+        glGenFramebuffers(1, &target.frameBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, target.frameBuffer);
+
+        target.color = texture_utils::empty(GL_RGBA8, size);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.color->getOpenGLName(), 0);
+        if (depth) glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth->getOpenGLName(), 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    void Postprocessor::deleteTarget(PostprocessTarget& target) {
+        if (!target.frameBuffer) return;
+        glDeleteFramebuffers(1, &target.frameBuffer);
+        delete target.color;
+        target.frameBuffer = 0;
+        target.color = nullptr;
+    }
+
+    void Postprocessor::setRenderScale(float scale) {
+        if (scale == renderScale) return;
+        renderScale = scale;
+        sceneSize = glm::max(glm::ivec2(glm::vec2(size) * scale), glm::ivec2(1));
+
+        // The targets are recreated (at the new size) the next time they are used.
+        for (auto& target : sceneTargets) deleteTarget(target);
+        delete depthTarget;
+        depthTarget = nullptr;
+        for (auto& [name, passes] : chains)
+            for (auto& pass : passes)
+                for (auto& target : pass.targets) deleteTarget(target);
+    }
+
+    bool Postprocessor::isNeeded(const std::string& name, bool effectsEnabled) const {
+        return (effectsEnabled && isActive(name)) || sceneSize != size;
+    }
+
+    void Postprocessor::bindSceneTarget() {
+        if (!sceneTargets[0].frameBuffer) {
+            // Both scene targets are RGBA8. The scene is drawn into the first one, so it also gets the depth target.
+            depthTarget = texture_utils::empty(GL_DEPTH_COMPONENT24, sceneSize);
+            createTarget(sceneTargets[0], sceneSize, depthTarget);
+            createTarget(sceneTargets[1], sceneSize, nullptr);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneTargets[0].frameBuffer);
+    }
+
+    void Postprocessor::apply(const std::string& name, bool effectsEnabled, GPUTimers& timers) {
+        OUR_PROFILE_ZONE("postprocess");
+        // If the effects are disabled (or there are none), the scene is only upsampled to the window.
+        auto chain = chains.find(name);
+        std::vector<PostprocessPass>& passes = effectsEnabled && chain != chains.end() && !chain->second.empty() ? chain->second : upsamplePasses;
+
+        // Comment:
+        // Every pass reads the output of the previous one (the first one reads the scene) and draws a fullscreen triangle.
+        // The data of the vertices (coordinates and texture coordinates) actually lie in the shader: assets/shaders/fullscreen.vert.
+        // A full resolution pass draws into the scene target that doesn't hold its input (or into the default framebuffer,
+        // at the window size, if it is the last pass). A scaled or iterated pass alternates between its own targets.
+        // The scene targets are smaller than the window if the render scale is below 1, so the last pass upsamples them.
+        glBindVertexArray(vertexArray);
+        Texture2D* input = sceneTargets[0].color;
+        int full = 0; // The full resolution target that was written last
+        for (size_t index = 0; index < passes.size(); index++) {
+            PostprocessPass& pass = passes[index];
+            TexturedMaterial* material = pass.material;
+            bool ownTargets = pass.scale < 1.0f || pass.iterations > 1;
+
+            timers.begin(pass.name);
+            if (ownTargets) {
+                glm::ivec2 scaledSize = glm::max(glm::ivec2(glm::vec2(sceneSize) * pass.scale), glm::ivec2(1));
+                if (!pass.targets[0].frameBuffer) {
+                    createTarget(pass.targets[0], scaledSize, nullptr);
+                    createTarget(pass.targets[1], scaledSize, nullptr);
+                }
+                glViewport(0, 0, scaledSize.x, scaledSize.y);
+                for (int iteration = 0; iteration < pass.iterations; iteration++) {
+                    glBindFramebuffer(GL_FRAMEBUFFER, pass.targets[iteration % 2].frameBuffer);
+                    material->texture = input;
+                    material->setup();
+                    material->shader->use();
+                    material->shader->set("iteration", (GLint)iteration);
+                    material->shader->set("iterations", (GLint)pass.iterations);
+                    glDrawArrays(GL_TRIANGLES, 0, 3);
+                    metrics::drawCalls.add();
+                    input = pass.targets[iteration % 2].color;
+                }
+            } else {
+                bool last = index + 1 == passes.size();
+                full = 1 - full;
+                glm::ivec2 targetSize = last ? size : sceneSize;
+                glViewport(0, 0, targetSize.x, targetSize.y);
+                glBindFramebuffer(GL_FRAMEBUFFER, last ? 0 : sceneTargets[full].frameBuffer);
+                material->texture = input;
+                material->setup();
+                material->shader->use();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                metrics::drawCalls.add();
+                input = sceneTargets[full].color;
+            }
+            timers.end();
+        }
+        glViewport(0, 0, size.x, size.y);
+    }
+
+    void Postprocessor::destroy() {
+        for (auto& [name, passes] : chains) {
+            for (auto& pass : passes) {
+                for (auto& target : pass.targets) deleteTarget(target);
+                delete pass.material->shader;
+                delete pass.material;
+            }
+        }
+        chains.clear();
+        for (auto& pass : upsamplePasses) {
+            delete pass.material->shader;
+            delete pass.material;
+        }
+        upsamplePasses.clear();
+
+        for (auto& target : sceneTargets) deleteTarget(target);
+        delete depthTarget;
+        depthTarget = nullptr;
+        delete sampler;
+        sampler = nullptr;
+        if (vertexArray) glDeleteVertexArrays(1, &vertexArray);
+        vertexArray = 0;
+    }
+
+}
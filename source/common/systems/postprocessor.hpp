@@ -0,0 +1,108 @@
+#pragma once
+
+#include "../material/material.hpp"
+#include "../texture/texture2d.hpp"
+#include "../texture/sampler.hpp"
+#include "gpu-timers.hpp"
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // A color target that the postprocess passes draw into.
+    struct PostprocessTarget {
+        GLuint frameBuffer = 0;
+        Texture2D* color = nullptr;
+    };
+
+    // A single fullscreen pass of a postprocess chain. It may apply multiple fused effects.
+    struct PostprocessPass {
+        std::string name;        // The name of the effect (or the names of the fused effects joined by " + ")
+        TexturedMaterial* material; // The material of the pass (its texture is set to the pass input before drawing)
+        float scale = 1.0f;      // The resolution of the pass relative to the screen
+        int iterations = 1;      // The number of times the pass is drawn, every time reading the output of the previous one
+        // The targets of the pass, if it is scaled or iterated (it alternates between them, and the next pass reads the last one).
+        PostprocessTarget targets[2] = {};
+    };
+
+    // Applies the postprocess effects to the scene.
+    // Comment:
+    // Every named entry of the "postprocess" configuration is a chain of effects, applied in order. An entry can be:
+    // - The path of a fragment shader (a chain of one effect).
+    // - An object: { "shader": "path/to/fragment-shader", "identity": true/false, "fuse": true/false, "scale": 0.5, "iterations": 2 }.
+    // - An array of the above.
+    // The scene is drawn into the first of two color targets, then every pass reads from one and writes to the other
+    // (ping-pong), except the last pass, which writes to the default framebuffer.
+    // Two kinds of effects are treated specially:
+    // - Identity effects (that output the scene as is, e.g. nothing.frag) are dropped. A chain that is left empty
+    //   isn't active, so the scene is drawn directly to the default framebuffer.
+    // - Per-pixel effects (that only read the pixel at their own position, e.g. grayscale.frag) define a function
+    //   "vec4 per_pixel(vec4 color, vec2 coord)" and only declare their main function if POSTPROCESS_FUSED isn't defined.
+    //   Consecutive per-pixel effects in a chain are fused into one generated shader that calls their functions in order,
+    //   so they cost a single fullscreen pass. They must not define conflicting names other than "per_pixel".
+    // Heavy effects (e.g. radial-blur.frag) can run at a lower resolution ("scale") and in multiple cheaper "iterations".
+    // Such a pass draws into its own pair of scaled targets (the first iteration downsamples its input while reading it),
+    // and the next pass reads its output with linear filtering, which upsamples it. If it is the last pass of its chain,
+    // an upsampling pass is added after it. Every iteration gets the uniforms "iteration" and "iterations".
+    // The targets are only created the first time an active chain is applied.
+    class Postprocessor {
+        glm::ivec2 size;
+        // The scene is drawn at a fraction of the window size (see "setRenderScale").
+        float renderScale = 1.0f;
+        glm::ivec2 sceneSize;
+        std::unordered_map<std::string, std::vector<PostprocessPass>> chains;
+        // A chain with a single pass that copies the scene to the window (used when the scene is scaled but no effect is applied).
+        std::vector<PostprocessPass> upsamplePasses;
+        Sampler* sampler = nullptr;
+        GLuint vertexArray = 0;
+
+        // The full resolution targets. The scene is drawn into the first one (which also has the depth target).
+        PostprocessTarget sceneTargets[2];
+        Texture2D* depthTarget = nullptr;
+
+        // Creates a color target of the given size (and attaches the depth target to it if it isn't null).
+        static void createTarget(PostprocessTarget& target, glm::ivec2 size, Texture2D* depth);
+        static void deleteTarget(PostprocessTarget& target);
+        // Creates the material of a pass from a fragment shader (given as a path, or as source code if "generated" is true).
+        TexturedMaterial* createMaterial(const std::string& shader, bool generated);
+        // Generates the source of a fragment shader that applies the given per-pixel effects (given as sources) in order.
+        static std::string fuseEffects(const std::vector<std::string>& sources);
+
+    public:
+        // Reads the chains from the "postprocess" configuration. "size" is the size of the default framebuffer.
+        void initialize(glm::ivec2 size, const nlohmann::json& effects);
+        void destroy();
+
+        // Returns true if there is a chain with the given name that has at least one pass.
+        bool isActive(const std::string& name) const;
+
+        // Sets the resolution of the scene relative to the window. If it is below 1, the scene must be drawn into the
+        // scene target (see "isNeeded"), and the last pass upsamples it to the window.
+        void setRenderScale(float scale);
+        // Returns the size that the scene should be drawn at when it is drawn into the scene target.
+        glm::ivec2 getSceneSize() const { return sceneSize; }
+
+        // Returns true if the scene should be drawn into the scene target and then applied: either because the chain
+        // with the given name is active (and the effects are enabled), or because the render scale is below 1.
+        bool isNeeded(const std::string& name, bool effectsEnabled) const;
+
+        // Binds the framebuffer that the scene should be drawn into before applying an active chain.
+        void bindSceneTarget();
+
+        // Applies the chain with the given name to the scene (or only upsamples it if the effects are disabled),
+        // writing the result to the default framebuffer. The GPU time of every pass is measured using the given timers.
+        void apply(const std::string& name, bool effectsEnabled, GPUTimers& timers);
+
+        // Returns true if the given fragment shader source just outputs the scene texture as is.
+        static bool isIdentityShader(const std::string& source);
+        // Returns true if the given fragment shader source is a per-pixel effect that can be fused.
+        static bool isPerPixelShader(const std::string& source);
+    };
+
+}
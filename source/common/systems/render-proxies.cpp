@@ -0,0 +1,151 @@
+#include "render-proxies.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../components/multiple-meshes-renderer.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace our {
+
+    void RenderProxies::synchronize(World* world, Entity* excluded) {
+        // The removals are applied first, since a removed entity may have been deleted, and a new entity could have
+        // been allocated at the same address and added after it.
+        if (!world->removedRenderables.empty()) {
+            std::sort(world->removedRenderables.begin(), world->removedRenderables.end(), std::less<Entity*>());
+            remove(world->removedRenderables);
+        }
+        for (Entity* entity : world->addedRenderables) {
+            if (entity != excluded) add(entity);
+        }
+        world->addedRenderables.clear();
+        world->removedRenderables.clear();
+
+        // Comment:
+        // The changed entities are only looked up in the map (a removed entity may have been deleted already).
+        // A new proxy is already up to date, and an entity that is marked twice is updated twice, which is harmless.
+        updatedCount = 0;
+        for (Entity* entity : world->changedTransforms) {
+            auto dependents = dependentProxies.find(entity);
+            if (dependents == dependentProxies.end()) continue;
+            for (size_t index : dependents->second) update(index);
+            updatedCount += dependents->second.size();
+        }
+        world->changedTransforms.clear();
+    }
+
+    void RenderProxies::add(Entity* entity) {
+        // Comment:
+        // The commands are filled right away by "update".
+        // A multiple meshes renderer gets a proxy per mesh, each with the material at the same position in its list.
+        if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer) {
+            proxies.push_back({entity, meshRenderer});
+            commands.emplace_back();
+            boundingSpheres.emplace_back();
+            movedTo.emplace_back();
+            commands.back().lodLevel = &meshRenderer->lodLevel;
+            addDependencies(proxies.size() - 1);
+            update(proxies.size() - 1);
+        } else if (auto multipleMeshRender = entity->getComponent<MultipleMeshesRendererComponent>(); multipleMeshRender) {
+            auto material = multipleMeshRender->materials->begin();
+            for (auto mesh = multipleMeshRender->meshes->listOfMeshes->begin(); mesh != multipleMeshRender->meshes->listOfMeshes->end(); mesh++) {
+                proxies.push_back({entity, nullptr});
+                commands.emplace_back();
+                boundingSpheres.emplace_back();
+                movedTo.emplace_back();
+                commands.back().mesh = (*mesh);
+                commands.back().material = (*material);
+                addDependencies(proxies.size() - 1);
+                update(proxies.size() - 1);
+                material++;
+            }
+        }
+    }
+
+    void RenderProxies::remove(const std::vector<Entity*>& entities) {
+        // The removed entities may have been deleted already, so their pointers are only compared, never dereferenced.
+        const size_t REMOVED = std::numeric_limits<size_t>::max();
+        size_t next = 0;
+        for (size_t index = 0; index < proxies.size(); index++) {
+            if (std::binary_search(entities.begin(), entities.end(), proxies[index].entity, std::less<Entity*>())) {
+                movedTo[index] = REMOVED;
+                continue;
+            }
+            movedTo[index] = next;
+            if (next != index) {
+                proxies[next] = proxies[index];
+                commands[next] = commands[index];
+                boundingSpheres[next] = boundingSpheres[index];
+            }
+            next++;
+        }
+        if (next == proxies.size()) return;
+
+        // Comment:
+        // The remaining proxies moved, so their indices in the map are renumbered in place and the deleted ones are dropped.
+        // An entity left without proxies (e.g. a removed one) is erased from the map, which only frees memory.
+        for (auto it = dependentProxies.begin(); it != dependentProxies.end();) {
+            std::vector<size_t>& indices = it->second;
+            size_t kept = 0;
+            for (size_t index : indices) {
+                if (movedTo[index] != REMOVED) indices[kept++] = movedTo[index];
+            }
+            indices.resize(kept);
+            if (indices.empty()) it = dependentProxies.erase(it);
+            else it++;
+        }
+
+        proxies.resize(next);
+        commands.resize(next);
+        boundingSpheres.resize(next);
+        movedTo.resize(next);
+    }
+
+    void RenderProxies::addDependencies(size_t index) {
+        for (Entity* entity = proxies[index].entity; entity; entity = entity->parent) dependentProxies[entity].push_back(index);
+    }
+
+    void RenderProxies::update(size_t index) {
+        const Proxy& proxy = proxies[index];
+        RenderCommand& command = commands[index];
+
+        if (proxy.meshRenderer) {
+            command.mesh = proxy.meshRenderer->mesh;
+            command.material = proxy.meshRenderer->material;
+        }
+        command.localToWorld = proxy.entity->getLocalToWorldMatrix();
+        command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+        command.boundingSphere = transformBoundingSphere(command.localToWorld, command.mesh->boundingSphereCenter, command.mesh->boundingSphereRadius);
+        boundingSpheres[index] = command.boundingSphere;
+    }
+
+    size_t RenderProxies::collect(const Frustum* frustum, std::vector<RenderCommand>& opaqueCommands, std::vector<RenderCommand>& transparentCommands) {
+        if (!frustum) {
+            for (const RenderCommand& command : commands) {
+                if (command.material->transparent) transparentCommands.push_back(command);
+                else opaqueCommands.push_back(command);
+            }
+            return 0;
+        }
+
+        visibility.resize(commands.size());
+        size_t visibleCount = cullSpheres(*frustum, boundingSpheres.data(), commands.size(), visibility.data());
+        for (size_t index = 0; index < commands.size(); index++) {
+            if (!visibility[index]) continue;
+            const RenderCommand& command = commands[index];
+            if (command.material->transparent) transparentCommands.push_back(command);
+            else opaqueCommands.push_back(command);
+        }
+        return commands.size() - visibleCount;
+    }
+
+    void RenderProxies::clear() {
+        proxies.clear();
+        commands.clear();
+        boundingSpheres.clear();
+        movedTo.clear();
+        dependentProxies.clear();
+        updatedCount = 0;
+    }
+
+}
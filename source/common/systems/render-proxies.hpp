@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../ecs/transform.hpp"
+#include "../mesh/mesh.hpp"
+#include "../material/material.hpp"
+#include "frustum-culling.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // The render command stores command that tells the renderer that it should draw
+    // the given mesh at the given localToWorld matrix using the given material
+    // The renderer will fill this struct using the mesh renderer components
+    struct RenderCommand {
+        glm::mat4 localToWorld;
+        glm::mat3 normalMatrix;   // The inverse transpose of the upper 3x3 part of localToWorld (filled after culling)
+        glm::vec3 center;
+        glm::vec4 boundingSphere; // The bounding sphere of the mesh in the world space (xyz: center, w: radius)
+        Mesh* mesh;
+        Material* material;
+        int* lodLevel = nullptr; // The level of detail state of the mesh renderer (null if the command has no levels of detail)
+    };
+
+    // Render proxies are the retained version of the render commands: every mesh drawn by a mesh renderer
+    // (or by a multiple meshes renderer) gets a proxy once, which keeps its render command between frames.
+    // Comment:
+    // The world records the entities that get a renderer component and the ones that are removed (see World::addedRenderables),
+    // and the proxies are created and deleted from these records when synchronizing. The world also records the entities
+    // whose transform changed (see Entity::markTransformChanged), and only the proxies of these entities and of their
+    // descendants recompute their matrix and bounding sphere, so a frame in which nothing moves doesn't touch the proxies.
+    // To find the proxies that depend on a changed entity, every entity is mapped to the proxies of itself and of its
+    // descendants. When proxies are deleted (which moves the proxies after them), the indices in the map are renumbered
+    // in place, so deleting proxies (e.g. when a coin is collected) doesn't allocate.
+    // The bounding spheres are kept in their own contiguous array, so the proxies can be frustum culled in batches
+    // while collecting them, and only the visible commands are copied to the lists of the frame.
+    class RenderProxies {
+        struct Proxy {
+            Entity* entity;
+            // The mesh renderer drawing this proxy, or null if it is one of the meshes of a multiple meshes renderer.
+            MeshRendererComponent* meshRenderer = nullptr;
+        };
+
+        // The proxies, their commands and the bounding spheres of their commands (at the same indices).
+        std::vector<Proxy> proxies;
+        std::vector<RenderCommand> commands;
+        std::vector<glm::vec4> boundingSpheres;
+        // The new index of every proxy while deleting proxies (at the same indices too, so it is always large enough).
+        std::vector<size_t> movedTo;
+        // The indices of the proxies of every entity and of its descendants.
+        std::unordered_map<Entity*, std::vector<size_t>> dependentProxies;
+        // The results of the frustum culling of the last collection.
+        std::vector<uint8_t> visibility;
+        // The number of proxies updated in the last synchronization.
+        size_t updatedCount = 0;
+
+        // Creates the proxies of all the meshes drawn by the given entity.
+        void add(Entity* entity);
+        // Deletes the proxies of the given entities (which must be sorted).
+        void remove(const std::vector<Entity*>& entities);
+        // Maps the proxy at the given index to its entity and to all its ancestors.
+        void addDependencies(size_t index);
+        // Recomputes the command of the proxy at the given index from its entity.
+        void update(size_t index);
+
+    public:
+        // Applies the additions and removals recorded by the world, then updates the proxies that changed.
+        // The given entity (e.g. the aircraft, which is drawn separately) never gets a proxy.
+        void synchronize(World* world, Entity* excluded);
+
+        // Appends the commands of the proxies that are inside the frustum (or of all of them if it is null) to the opaque
+        // and transparent lists. Returns the number of culled commands.
+        size_t collect(const Frustum* frustum, std::vector<RenderCommand>& opaqueCommands, std::vector<RenderCommand>& transparentCommands);
+
+        // Deletes all the proxies.
+        void clear();
+
+        size_t size() const { return proxies.size(); }
+        size_t getUpdatedCount() const { return updatedCount; }
+    };
+
+}
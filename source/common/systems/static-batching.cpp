@@ -0,0 +1,111 @@
+#include "static-batching.hpp"
+#include "normal-matrices.hpp"
+#include "../asset-loader.hpp"
+#include "../components/camera.hpp"
+#include "../components/free-camera-controller.hpp"
+#include "../components/mesh-renderer.hpp"
+#include "../components/movement.hpp"
+#include "../components/multiple-meshes-renderer.hpp"
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // Returns true if the entity never moves nor gets removed while playing.
+    static bool isStatic(World* world, Entity* entity) {
+        if (entity == world->airCraftEntity) return false;
+        if (entity->typeOfChildMesh == COLLECTABLE_COIN || entity->typeOfChildMesh == SPEED_COLLECTABLE) return false;
+        for (Entity* it = entity; it; it = it->parent) {
+            if (it->getComponent<MovementComponent>() || it->getComponent<CameraComponent>() || it->getComponent<FreeCameraControllerComponent>())
+                return false;
+        }
+        return true;
+    }
+
+    // Returns true if the given mesh can be merged into a batch of the given material.
+    static bool canBatch(Mesh* mesh, Material* material) {
+        return mesh && material && !material->transparent && mesh->getLODCount() == 1;
+    }
+
+    int batchStaticGeometry(World* world) {
+        // A piece of geometry to merge: the mesh and the local to world matrix of the entity drawing it.
+        struct Piece {
+            Mesh* mesh;
+            glm::mat4 localToWorld;
+        };
+        std::map<Material*, std::vector<Piece>> groups;
+        std::vector<Entity*> mergedEntities;
+
+        // Collect the pieces of the static entities whose meshes can all be merged.
+        for (Entity* entity : world->getEntities()) {
+            if (!isStatic(world, entity)) continue;
+            if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer) {
+                if (!canBatch(meshRenderer->mesh, meshRenderer->material)) continue;
+                groups[meshRenderer->material].push_back({meshRenderer->mesh, entity->getLocalToWorldMatrix()});
+                mergedEntities.push_back(entity);
+            } else if (auto multipleMeshRender = entity->getComponent<MultipleMeshesRendererComponent>(); multipleMeshRender) {
+                bool mergeable = true;
+                auto material = multipleMeshRender->materials->begin();
+                for (auto mesh : *multipleMeshRender->meshes->listOfMeshes) mergeable = mergeable && canBatch(mesh, *(material++));
+                if (!mergeable) continue;
+
+                glm::mat4 localToWorld = entity->getLocalToWorldMatrix();
+                material = multipleMeshRender->materials->begin();
+                for (auto mesh : *multipleMeshRender->meshes->listOfMeshes) groups[*(material++)].push_back({mesh, localToWorld});
+                mergedEntities.push_back(entity);
+            }
+        }
+
+        int batches = 0;
+        std::vector<Vertex> vertices, pieceVertices;
+        std::vector<unsigned int> elements, pieceElements;
+        for (auto& [material, pieces] : groups) {
+            vertices.clear();
+            elements.clear();
+            for (const Piece& piece : pieces) {
+                piece.mesh->readData(pieceVertices, pieceElements);
+                glm::mat3 normalMatrix = computeNormalMatrix(piece.localToWorld);
+                // A mirroring transform flips the triangles, so their vertex order is reversed to keep them front facing.
+                bool mirrored = glm::determinant(glm::mat3(piece.localToWorld)) < 0.0f;
+
+                unsigned int base = (unsigned int)vertices.size();
+                for (Vertex vertex : pieceVertices) {
+                    vertex.position = glm::vec3(piece.localToWorld * glm::vec4(vertex.position, 1.0f));
+                    glm::vec3 normal = normalMatrix * vertex.normal;
+                    float length = glm::length(normal);
+                    vertex.normal = length > 0.0f ? normal / length : normal;
+                    vertices.push_back(vertex);
+                }
+                for (size_t index = 0; index + 2 < pieceElements.size(); index += 3) {
+                    elements.push_back(base + pieceElements[index]);
+                    elements.push_back(base + pieceElements[index + (mirrored ? 2 : 1)]);
+                    elements.push_back(base + pieceElements[index + (mirrored ? 1 : 2)]);
+                }
+            }
+
+            Mesh* mesh = new Mesh(vertices, elements);
+            AssetLoader<Mesh>::add("static-batch-" + std::to_string(batches), mesh);
+
+            Entity* entity = world->add();
+            entity->name = "static-batch-" + std::to_string(batches);
+            MeshRendererComponent* meshRenderer = entity->addComponent<MeshRendererComponent>();
+            meshRenderer->mesh = mesh;
+            meshRenderer->material = material;
+
+            std::cout << "Static batch " << batches << ": " << pieces.size() << " meshes merged into "
+                      << elements.size() / 3 << " triangles." << std::endl;
+            batches++;
+        }
+
+        // The merged entities keep their other components (e.g. lights), but they are no longer drawn on their own.
+        for (Entity* entity : mergedEntities) {
+            if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer) entity->deleteComponent(meshRenderer);
+            if (auto multipleMeshRender = entity->getComponent<MultipleMeshesRendererComponent>(); multipleMeshRender) entity->deleteComponent(multipleMeshRender);
+        }
+        return batches;
+    }
+
+}
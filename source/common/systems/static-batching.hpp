@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+
+namespace our {
+
+    // Merges the static geometry of the world into one mesh per material, so that it is drawn with one draw call per material.
+    // Comment:
+    // An entity is static if neither it nor any of its ancestors has a movement, camera or camera controller component,
+    // and if it can't be removed at runtime (the collectables) and isn't the aircraft.
+    // The meshes of the static entities are grouped by material and their vertices are transformed to the world space
+    // (positions by the model matrix, normals by the normal matrix), then every group is merged into a new mesh
+    // (added to the AssetLoader, so it is freed with the other assets) drawn by a new entity.
+    // The renderer components of the merged entities are deleted, so they are no longer drawn on their own.
+    // The following are left to the normal path:
+    // - Meshes with levels of detail (e.g. the spheres), since they benefit from LOD selection, impostors and instancing.
+    // - Transparent materials, since the transparent objects must be sorted individually.
+    // Returns the number of merged meshes that were created.
+    int batchStaticGeometry(World* world);
+
+}
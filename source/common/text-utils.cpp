@@ -5,6 +5,8 @@
 #include <map>
 
 #include "./text-utils.hpp"
+#include "./profiler.hpp"
+#include "./metrics.hpp"
 
 // This is for the FreeType font library.
 #include <ft2build.h>
@@ -179,6 +181,7 @@ namespace our {
     }
 
     void RenderText(Text* text, glm::ivec2 windowSize, std::map<char, Character>*characters) {
+        OUR_PROFILE_ZONE("text");
         
         // First, we activate/use the shader program associated with the text component.
         text->shader->use();
@@ -201,7 +204,12 @@ namespace our {
         text->textPipelineState.setup();
 
         // Activating Texture 0, and binding to the vertex array.
+        // Comment:
+        // The sampler bound to unit 0 by the last material is unbound, so the glyph textures are sampled using their own
+        // parameters. The materials' samplers use mipmapped filtering, which made the glyphs (that have no mipmaps) incomplete,
+        // and the text invisible unless a postprocess pass (whose sampler isn't mipmapped) was drawn before it.
         glActiveTexture(GL_TEXTURE0);
+        glBindSampler(0, 0);
         glBindVertexArray(text->VAO);
 
         // Initialize the initial x and y position with the supplied values.
@@ -283,12 +291,14 @@ namespace our {
             // Check this for more: https://registry.khronos.org/OpenGL-Refpages/gl4/html/glBufferSubData.xhtml 
             glBindBuffer(GL_ARRAY_BUFFER, text->VBO);
             glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+            metrics::bytesUploaded.add(sizeof(vertices));
 
             // After filling the buffer's data, we unbind it.
             glBindBuffer(GL_ARRAY_BUFFER, 0);
 
             // Draw the vertices in the vertex array bound above (6 vertices for a quad).
             glDrawArrays(GL_TRIANGLES, 0, 6);
+            metrics::drawCalls.add();
 
             x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
         }
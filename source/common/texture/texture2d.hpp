@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glad/gl.h>
+#include <cstddef>
 
 namespace our {
 
@@ -28,6 +29,24 @@ namespace our {
             return name;
         }
 
+        // Returns the size (in bytes) of all the levels of this texture, assuming 4 bytes per texel (the textures are loaded as RGBA8).
+        // It reads the sizes of the levels from OpenGL, so it shouldn't be called every frame.
+        size_t getMemorySize() const {
+            GLint bound = 0;
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+            bind();
+            size_t size = 0;
+            for (GLint level = 0; level < 16; level++) {
+                GLint width = 0, height = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &height);
+                if (width == 0 || height == 0) break;
+                size += (size_t)width * height * 4;
+            }
+            glBindTexture(GL_TEXTURE_2D, bound);
+            return size;
+        }
+
         // This method binds this texture to GL_TEXTURE_2D
         void bind() const {
             //DONE: (Req 5) Complete this 
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "profiler.hpp"
+
+namespace our {
+
+    // A small pool of worker threads used to split per-frame work (e.g. culling) into independent jobs.
+    // The pool only runs one batch of jobs at a time: "run" hands the jobs to the workers, helps
+    // executing them on the calling thread, and returns once all of them are done.
+    // Jobs must not touch OpenGL since the context is only current on the main thread.
+    class ThreadPool {
+        // The state of one call to "run". A state is never reset while a worker holds it, so a worker that wakes up late
+        // can never pick a job index belonging to a newer batch (see "run").
+        // The job is called through a function pointer instead of being copied into a std::function (which may allocate),
+        // since it lives on the stack of "run", which only returns once all the jobs are done.
+        struct Batch {
+            void (*invoke)(const void* job, size_t index) = nullptr;
+            const void* job = nullptr;
+            size_t count = 0;
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> completed{0};
+        };
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake, finished;
+        std::shared_ptr<Batch> batch;
+        unsigned long long generation = 0;
+        bool stopping = false;
+
+        // Executes jobs from the given batch until there are no more jobs to take.
+        void work(Batch& current) {
+            size_t index;
+            while ((index = current.next.fetch_add(1)) < current.count) {
+                OUR_PROFILE_ZONE("job");
+                current.invoke(current.job, index);
+                if (current.completed.fetch_add(1) + 1 == current.count) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+
+    public:
+        // Creates a pool with the given number of worker threads (in addition to the calling thread).
+        explicit ThreadPool(size_t workerCount = 0) {
+            for (size_t index = 0; index < workerCount; index++) {
+                workers.emplace_back([this, index]() {
+                    Profiler::setThreadName("worker " + std::to_string(index));
+                    unsigned long long seen = 0;
+                    while (true) {
+                        std::shared_ptr<Batch> current;
+                        {
+                            std::unique_lock<std::mutex> lock(mutex);
+                            wake.wait(lock, [&]() { return stopping || generation != seen; });
+                            if (stopping) return;
+                            seen = generation;
+                            current = batch;
+                        }
+                        work(*current);
+                    }
+                });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers) worker.join();
+        }
+
+        // Returns the number of threads that execute jobs (the workers and the calling thread).
+        size_t size() const { return workers.size() + 1; }
+
+        // Runs job(0), job(1), ..., job(count - 1) on the pool and waits for all of them to finish.
+        template<typename Job>
+        void run(size_t count, const Job& job) {
+            if (count == 0) return;
+            if (workers.empty() || count == 1) {
+                for (size_t index = 0; index < count; index++) job(index);
+                return;
+            }
+
+            // Comment:
+            // The state of the previous call is reused if no worker holds it anymore, so a frame doesn't allocate a new one.
+            // The workers only take the state while holding the lock, so if only the pool holds it now, no worker can take it
+            // before it is reset (a worker that wakes up late takes the new batch, which is what it would do with a new state).
+            // The fence pairs with the release of the workers' references, so their last reads of the state happen before it is reset.
+            std::shared_ptr<Batch> current;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (batch && batch.use_count() == 1) {
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    current = batch;
+                } else {
+                    current = std::make_shared<Batch>();
+                }
+                current->invoke = [](const void* job, size_t index) { (*static_cast<const Job*>(job))(index); };
+                current->job = &job;
+                current->count = count;
+                current->next.store(0, std::memory_order_relaxed);
+                current->completed.store(0, std::memory_order_relaxed);
+                batch = current;
+                generation++;
+            }
+            wake.notify_all();
+
+            work(*current);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]() { return current->completed.load() == current->count; });
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+    };
+
+}
@@ -20,6 +20,32 @@ int main(int argc, char** argv) {
     // This is useful for testing multiple configurations in a batch
     // Default: 0 where the application runs indefinitely until manually closed
     int run_for_frames = args.get<int>("f", 0);
+    // headless runs the application without a window (and without a display), drawing into an offscreen buffer
+    // This is useful for running benchmarks and taking screenshots on machines without a display or a GPU
+    // Default: false
+    bool headless = args.get<bool>("headless", false);
+    // benchmark runs the benchmark described in the "benchmark" section of the config and writes its results to a JSON file
+    // (benchmark-output overrides the path of the results). The number of frames comes from the config instead of "-f".
+    // Default: false
+    bool benchmark = args.get<bool>("benchmark", false);
+    std::string benchmark_output = args.get<std::string>("benchmark-output", "");
+    // record is the path of a file to which the input of the run is recorded
+    // replay is the path of a recording whose input is replayed instead of the user input
+    // (replay-deltas makes the replay use the recorded frame delta times, so it simulates exactly the same frames)
+    // seed fixes the seed of the random number generator used to build the scene (a replay uses the recorded seed,
+    // and a benchmark uses the seed of its configuration unless one is given here)
+    // Default: no recording, no replay and a seed from the current time
+    std::string record_path = args.get<std::string>("record", "");
+    std::string replay_path = args.get<std::string>("replay", "");
+    bool replay_deltas = args.get<bool>("replay-deltas", false);
+    std::optional<unsigned int> seed = args.get<unsigned int>("seed");
+    // profile records the zones of the profiler from the start (even if the "profiler" section of the config doesn't enable it)
+    // The trace is written when F11 is pressed and at exit
+    // Default: false
+    bool profile = args.get<bool>("profile", false);
+    // metrics records the metrics of every frame (frame time, draw calls, etc.) to the given file (CSV if it ends with .csv, binary otherwise)
+    // Default: the "metrics" section of the config
+    std::string metrics_path = args.get<std::string>("metrics", "");
 
     // Open the config file and exit if failed
     std::ifstream file_in(config_path);
@@ -33,6 +59,13 @@ int main(int argc, char** argv) {
 
     // Create the application
     our::Application app(app_config);
+    app.setHeadless(headless);
+    if(benchmark) app.enableBenchmark(benchmark_output);
+    if(!record_path.empty()) app.enableRecording(record_path);
+    if(!replay_path.empty()) app.enableReplay(replay_path, replay_deltas);
+    if(seed) app.setRandomSeed(*seed);
+    if(profile) app.enableProfiling();
+    if(!metrics_path.empty()) app.enableMetrics(metrics_path);
     
     // Register all the states of the project in the application
     app.registerState<Menustate>("menu");
@@ -41,8 +74,11 @@ int main(int argc, char** argv) {
     app.registerState<Winnerstate>("winner");
 
     // Then choose the state to run based on the option "start-scene" in the config
-    if(app_config.contains(std::string{"start-scene"})){
-        app.changeState(app_config["start-scene"].get<std::string>());
+    // (a benchmark starts in the scene of its own configuration instead, so it measures the race and not the menu)
+    std::string start_scene = app_config.value("start-scene", "");
+    if(benchmark && !app.getBenchmark().getScene().empty()) start_scene = app.getBenchmark().getScene();
+    if(!start_scene.empty()){
+        app.changeState(start_scene);
     }
 
     // Finally run the application
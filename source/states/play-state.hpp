@@ -10,6 +10,7 @@
 #include <systems/forward-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/movement.hpp>
+#include <systems/static-batching.hpp>
 #include <asset-loader.hpp>
 
 #include "../common/components/free-camera-controller.hpp"
@@ -58,6 +59,16 @@ class Playstate: public our::State {
 
     // This records the time the player took to finish the race.
     float elapsedTime = 0.0;
+
+    // The sum of the delta times of all the frames of this state. The timers of the game (e.g. the speedup) use it instead of
+    // the real time, so a replayed race (with the recorded delta times) behaves exactly like the recorded one.
+    double stateTime = 0.0;
+
+    // Whether the renderer statistics (visible/culled commands) are displayed every frame.
+    bool showRendererStats = false;
+
+    // The initial position of the camera. In a benchmark, the scripted camera path is relative to it.
+    glm::vec3 initialCameraPosition = glm::vec3(0.0f);
     void onInitialize() override {
 
         std::cout << "Play state type: " << type << std::endl;
@@ -110,6 +121,7 @@ class Playstate: public our::State {
             if (track) {
                 track->getOwner()->localTransform.scale.z = world.track.trackLength;
                 track->getOwner()->localTransform.position.z = -3.9 * world.track.trackLength;
+                track->getOwner()->markTransformChanged();
                 world.setTrackRelatedVariables(track);
             }
 
@@ -151,6 +163,8 @@ class Playstate: public our::State {
         if (camera)
             // Centering the camera on the desired position.
             camera->setPosition(glm::vec3( (world.track.tracksFarLeft.x+world.track.tracksFarRight.x)/2.0, camera->getOwner()->localTransform.position.y, camera->getOwner()->localTransform.position.z));
+        if (camera)
+            initialCameraPosition = camera->getOwner()->localTransform.position;
 
         // We create the randomized artifacts.
         this->createRandomizedArtifacts();
@@ -166,6 +180,13 @@ class Playstate: public our::State {
 
         std::cout << "The overall number of light sources will be: " << world.setOfLights.size() << std::endl;
 
+        // Now that all the entities are created, the static ones (the track, the finish line, etc.) are merged
+        // into one mesh per material (see our::batchStaticGeometry). The moving entities keep the normal path.
+        if (config["renderer"].value("static-batching", true)) {
+            int batches = our::batchStaticGeometry(&world);
+            std::cout << "The static geometry was merged into " << batches << " meshes." << std::endl;
+        }
+
         // We create the necessary text to be displayed, mainly: text to display time,
         // text to display the current player, and text to display the number of collected
         // artifacts out of total number of artifacts.
@@ -200,6 +221,24 @@ class Playstate: public our::State {
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
         renderer.initialize(size, config["renderer"]);
+        showRendererStats = config["renderer"].value("show-stats", false);
+    }
+
+    // If enabled in the renderer config, display the statistics of the last rendered frame.
+    void onImmediateGui() override {
+        if (!showRendererStats) return;
+        const our::RenderStats& stats = renderer.getStats();
+        ImGui::Begin("Renderer Stats");
+        ImGui::Text("Visible commands: %d", stats.visibleCommands);
+        ImGui::Text("Culled commands: %d", stats.culledCommands);
+        ImGui::Text("Occluded commands: %d (%d occluders)", stats.occludedCommands, stats.occluders);
+        ImGui::Text("Updated render proxies: %d", stats.updatedProxies);
+        ImGui::Text("Draw calls: %d (%d instanced, %d multi-draw batches)", stats.drawCalls, stats.instancedBatches, stats.multiDrawBatches);
+        ImGui::Text("Triangles: %d", stats.triangles);
+        ImGui::Text("Impostors: %d", stats.impostors);
+        for (auto& [name, milliseconds] : renderer.getGPUTimes())
+            ImGui::Text("GPU %s: %.3f ms", name, milliseconds);
+        ImGui::End();
     }
 
     // This function creates the finish line's entity, and all related info, and adds
@@ -227,7 +266,8 @@ class Playstate: public our::State {
     // This function creates a random number of collectable artifacts at random locations.
     void createRandomizedArtifacts() {
         
-        srand(time(0));
+        // The seed comes from the application, so it can be fixed (e.g. to replay a recorded race).
+        srand(getApp()->getRandomSeed());
         
         totalNumberOfArtifacts = 0;
         int numberOfSegments = 10;
@@ -322,7 +362,7 @@ class Playstate: public our::State {
         std::string planets[2] = {"planet-1", "planet-2"};
         
         // Setting the seed of the integer random number generator.
-        srand(time(0));
+        srand(getApp()->getRandomSeed());
 
         // Generating a random number of planets, between minPlanets
         // and maxPlanets.
@@ -467,7 +507,7 @@ class Playstate: public our::State {
     // with varying linear velocities.
     void createRandomizedAircrafs() {
 
-        srand(time(0));
+        srand(getApp()->getRandomSeed());
 
         // Create a number of randomized aircrafts.
         int numberOfFlyingArtifacts = rand() % 10;
@@ -507,9 +547,15 @@ class Playstate: public our::State {
     void onDraw(double deltaTime) override {
 
         speed.inEffect = false;
+        stateTime += deltaTime;
+
+        // In a benchmark, the CPU time of every system is measured (see "benchmark.hpp").
+        our::Benchmark& benchmark = getApp()->getBenchmark();
         
         // Here, we just run a bunch of systems to control the world logic
+        benchmark.beginSystem("movement");
         movementSystem.update(&world, (float)deltaTime);
+        benchmark.endSystem();
         
         // forbiddenAccess: whether the player has tried to enter a forbidden zone.
         // forbiddenCollision: whether the player has collided with a planet. 
@@ -524,22 +570,35 @@ class Playstate: public our::State {
         // check if there is any forbidden collisions first, and if there is not, we update
         // the actual camera position to be updatedCameraPosition.
         glm::vec3 updatedCameraPosition;
+        benchmark.beginSystem("camera-controller");
         our::Entity* camerasParent = cameraController.update(&world, (float)deltaTime, &updatedCameraPosition, &forbiddenAccess, gameConfig, speed.timeSince);
+        benchmark.endSystem();
         
         our::CameraComponent* camera = camerasParent->getComponent<our::CameraComponent>();
         our::FreeCameraControllerComponent* cameraControllerComponente = camerasParent->getComponent<our::FreeCameraControllerComponent>();
         if (!camera || !cameraControllerComponente)
             std::cerr << "ERROR:: MISSING CAMERA OR CONTROLLER IN PLAY STATE" << std::endl;
 
+        // In a benchmark with a camera path, the camera follows the path instead of the controller (even through the planets).
+        glm::vec3 pathPosition, pathRotation;
+        bool followingPath = benchmark.sampleCamera(pathPosition, pathRotation);
+        if (followingPath) {
+            updatedCameraPosition = initialCameraPosition + pathPosition;
+            camerasParent->localTransform.rotation = pathRotation;
+            camerasParent->markTransformChanged();
+        }
+
         // Call the collision system with the updated aircraft position and obtain the remaining
         // number of collectables to update the text.
         // The updated aircraft position = updatedCameraPosition + the difference between the two
         // (the camera is higher in y-axis, and earlier (larger z) in the z-axis).
         glm::vec3 position = gameConfig.movementRestriction.hideAircraft ? updatedCameraPosition : updatedCameraPosition+gameConfig.hyperParametrs.cameraAircraftDiff;
+        benchmark.beginSystem("collision");
         int remainingCollectables = collisionSystem.update(&world, position, getApp()->getSoundEngine(), &forbiddenCollision, &speed);
+        benchmark.endSystem();
 
         // If a forbidden collision has not happen, update the actual camera position.
-        if (!forbiddenCollision) {
+        if (!forbiddenCollision || followingPath) {
             // actually updating the position of the camera.
             camera->setPosition(updatedCameraPosition);
         }
@@ -550,7 +609,7 @@ class Playstate: public our::State {
         // We update the following:
         /*
             1. Field of view angle of the camera.
-            2. The speed.timeSince to be the current time.
+            2. The speed.timeSince to be the current state time (see stateTime).
             3. The position sensitivity to be higher (faster movement)
             4. We apply a new postprocess effect, and save the name of the current one in use in
                speed.pervPostprocess
@@ -561,7 +620,7 @@ class Playstate: public our::State {
         if (speed.timeSince == 0.0) {
             if (speed.inEffect) {
                 camera->fovY = 3.0;
-                speed.timeSince = glfwGetTime();
+                speed.timeSince = (float)stateTime;
                 cameraControllerComponente->positionSensitivity = glm::vec3(10.0, 10.0, 10.0);
                 speed.zAtTimeOfCollection = updatedCameraPosition.z;
                 speed.pervPostprocess = renderer.postprocessInEffect;
@@ -577,7 +636,7 @@ class Playstate: public our::State {
                 3. We reset timeSince, zAtTimeOfCollection, inEffect.
         */
         else {
-            if (glfwGetTime() - speed.timeSince > 10.0) {
+            if (stateTime - speed.timeSince > 10.0) {
                 camera->fovY = 1.518;
                 cameraControllerComponente->positionSensitivity = glm::vec3(6.0, 6.0, 6.0);
                 renderer.postprocessInEffect = speed.pervPostprocess;
@@ -587,10 +646,17 @@ class Playstate: public our::State {
             }
         }
 
-        // And finally we use the renderer system to draw the scene
+        // And finally we use the renderer system to draw the scene (with the quality picked by the quality governor)
+        renderer.setQuality(getApp()->getQualitySettings());
+        benchmark.beginSystem("renderer");
         renderer.render(&world, forbiddenAccess, gameConfig);
+        benchmark.endSystem();
+        benchmark.addRenderCounts(renderer.getStats().drawCalls, renderer.getStats().triangles);
 
         // Rendering currentPlayerText.
+        // The GPU time of the three texts is measured as one pass (a timer can only be measured once per frame).
+        benchmark.beginSystem("text");
+        renderer.getGPUTimers().begin("text");
         glm::ivec2 windowSize = getApp()->getWindowSize();
         our::RenderText(
             currentPlayerText, 
@@ -608,7 +674,8 @@ class Playstate: public our::State {
         } else
             elapsedTime += deltaTime;
         
-        timeText->displayedText = our::string_format("%02d:%02d", (int(elapsedTime)/60), (int)elapsedTime%60);
+        // The texts are formatted into their strings, so they reuse their memory every frame.
+        our::string_format(timeText->displayedText, "%02d:%02d", (int(elapsedTime)/60), (int)elapsedTime%60);
         our::RenderText(
             timeText,
             windowSize,
@@ -616,12 +683,38 @@ class Playstate: public our::State {
         );
 
         // Rendering the text of the number of collected number of artifacts.
-        numberOfCollectedArtifactsText->displayedText = our::string_format("%d/%d", totalNumberOfArtifacts - remainingCollectables, totalNumberOfArtifacts); 
+        our::string_format(numberOfCollectedArtifactsText->displayedText, "%d/%d", totalNumberOfArtifacts - remainingCollectables, totalNumberOfArtifacts);
         our::RenderText(
             numberOfCollectedArtifactsText,
             windowSize,
             getApp()->getCharacterMap()
         );
+        renderer.getGPUTimers().end();
+        benchmark.endSystem();
+
+        // Report the GPU time of the passes (a few frames old) to the quality governor (see "Application::reportGPUTime").
+        float gpuMilliseconds = 0.0f;
+        for (auto& [name, milliseconds] : renderer.getGPUTimes()) gpuMilliseconds += milliseconds;
+        getApp()->reportGPUTime(gpuMilliseconds / 1000.0);
+
+        // Report the counts and the GPU times of this frame to the performance HUD (if it is visible).
+        our::PerformanceHUD& hud = getApp()->getPerformanceHUD();
+        if (hud.isVisible()) {
+            const our::RenderStats& stats = renderer.getStats();
+            hud.setCount("Entities", (long long)world.getEntities().size());
+            hud.setCount("Lights", (long long)world.setOfLights.size());
+            hud.setCount("Active lights", stats.activeLights);
+            hud.setCount("Visible commands", stats.visibleCommands);
+            hud.setCount("Frustum culled", stats.culledCommands);
+            hud.setCount("Occlusion culled", stats.occludedCommands);
+            hud.setCount("Impostors", stats.impostors);
+            hud.setCount("Draw calls", stats.drawCalls);
+            hud.setCount("Instanced batches", stats.instancedBatches);
+            hud.setCount("Multi-draw batches", stats.multiDrawBatches);
+            hud.setCount("Triangles", stats.triangles);
+            hud.setCount("Remaining collectables", remainingCollectables);
+            hud.setGPUTimes(renderer.getGPUTimes());
+        }
 
         // If you've finished your turn (here the check is whether your reach your finish line), take turns. 
         if (camera->getOwner()->localTransform.position.z <= world.track.tracksZFurthest + 10) {